@@ -0,0 +1,79 @@
+# -*- coding: utf-8 -*-
+"""
+Reader for the single file binary output (output_format binary), see src/columnar_file.hpp for the layout.
+
+    header, data = read_columnar_output("path/runName.tdmc")
+    data["host_prevalences"]               #1D array, one value per output time
+    data["circulating_antigen_frequency"]  #2D array, (output times, num_phenotypes)
+
+The file is memory mapped, so columns stored in a single chunk (i.e. from non-streamed runs) are read lazily without copying.
+Streamed runs write one chunk per flush and their chunks are concatenated into a new array.
+"""
+
+import numpy as np
+
+MAGIC = b"TDMCOL\x00\x01"
+CHUNK_TAG = b"CHNK"
+
+def _padded(offset):
+    return (offset + 7) & ~7
+
+def _read_string(raw, offset):
+    length = int(raw[offset:offset+4].view("<u4")[0])
+    offset += 4
+    return raw[offset:offset+length].tobytes().decode("utf-8"), offset+length
+
+def read_columnar_output(filename):
+    raw = np.memmap(filename, dtype=np.uint8, mode='r')
+    if raw[0:8].tobytes() != MAGIC:
+        raise ValueError(filename + " is not a columnar output file (or is a different version).")
+
+    #Header: the run's calling arguments. Lines are "name value", apart from the executable name.
+    headerText, offset = _read_string(raw, 8)
+    offset = _padded(offset)
+    header = {}
+    for line in headerText.split("\n"):
+        parts = line.split(" ", 1)
+        if len(parts) == 2:
+            header[parts[0]] = parts[1]
+
+    #Schema
+    numColumns = int(raw[offset:offset+4].view("<u4")[0])
+    offset += 4
+    columns = []
+    for c in range(numColumns):
+        name, offset = _read_string(raw, offset)
+        dtype = raw[offset:offset+3].tobytes().decode("ascii")
+        width = int(raw[offset+4:offset+8].view("<u4")[0])
+        offset += 8
+        columns.append((name, np.dtype(dtype), width))
+    offset = _padded(offset)
+
+    #Chunks. A partly written final chunk (e.g. from a killed run) is ignored.
+    chunks = [[] for c in columns]
+    while offset + 16 <= len(raw):
+        if raw[offset:offset+4].tobytes() != CHUNK_TAG:
+            raise ValueError("Corrupt chunk in " + filename)
+        column = int(raw[offset+4:offset+8].view("<u4")[0])
+        rows = int(raw[offset+8:offset+16].view("<u8")[0])
+        offset += 16
+        name, dtype, width = columns[column]
+        nbytes = rows * width * dtype.itemsize
+        if offset + nbytes > len(raw):
+            break
+        chunks[column].append(raw[offset:offset+nbytes].view(dtype))
+        offset = _padded(offset + nbytes)
+
+    data = {}
+    for (name, dtype, width), columnChunks in zip(columns, chunks):
+        if len(columnChunks) == 0:
+            values = np.zeros(0, dtype=dtype)
+        elif len(columnChunks) == 1:
+            values = columnChunks[0]
+        else:
+            values = np.concatenate(columnChunks)
+        if width > 1:
+            values = values.reshape((-1, width))
+        data[name] = values
+
+    return header, data
@@ -2,6 +2,8 @@
 #include <string>
 
 class MosquitoManager;
+class ParamManager;
+namespace checkpoint { class Writer; class Reader; }
 
 //Virtual base class for all adaptors.
 class Adaptor
@@ -15,5 +17,8 @@ public:
     virtual unsigned int get_start_t() const = 0;
     virtual unsigned int get_stop_t() const = 0;
     virtual std::string get_adaptor_name() const = 0;
+    //Progress that isn't held in the parameters themselves, for checkpoints. Most adaptors have none.
+    virtual void save(checkpoint::Writer& out) const {  }
+    virtual void load(checkpoint::Reader& in) {  }
     virtual ~Adaptor() {  };
 };
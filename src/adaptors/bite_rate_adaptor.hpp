@@ -4,11 +4,12 @@
 class BiteRateAdaptor : public Adaptor
 {
 private:
+    ParamManager& params;
     unsigned int tStart, tStop;
     std::string adaptorName;
     float targetValue;
 public:
-    BiteRateAdaptor(unsigned int tStart, unsigned int tStop, float targetValue);
+    BiteRateAdaptor(unsigned int tStart, unsigned int tStop, float targetValue, ParamManager& params);
     void update(unsigned int time);
     unsigned int get_start_t() const { return tStart; }
     unsigned int get_stop_t() const { return tStop; }
@@ -1,15 +1,17 @@
 #include "mosquito_population_adaptor.hpp"
+#include "../checkpoint.hpp"
 #include "../mosquito_manager.hpp"
+#include "../param_manager.hpp"
 #include <cmath>
 #include <iostream>
 
-MosquitoPopulationAdaptor::MosquitoPopulationAdaptor(unsigned int tStart, unsigned int tStop, unsigned int targetPopulation, MosquitoManager* mManager)
-    : tStart(tStart), tStop(tStop), adaptorName("MosquitoPopulationAdaptor"), targetPopulation(targetPopulation), mManager(mManager)
+MosquitoPopulationAdaptor::MosquitoPopulationAdaptor(unsigned int tStart, unsigned int tStop, unsigned int targetPopulation, MosquitoManager* mManager, ParamManager& params)
+    : params(params), tStart(tStart), tStop(tStop), adaptorName("MosquitoPopulationAdaptor"), targetPopulation(targetPopulation), mManager(mManager)
 {
-    ParamManager::dyn_num_mosquitoes = true;
+    params.dyn_num_mosquitoes = true;
 
-    if (targetPopulation > ParamManager::max_num_mosquitoes)
-        ParamManager::max_num_mosquitoes = targetPopulation;
+    if (targetPopulation > params.max_num_mosquitoes)
+        params.max_num_mosquitoes = targetPopulation;
 }
 
 
@@ -33,4 +35,12 @@ void MosquitoPopulationAdaptor::update(unsigned int time)
     }
 }
 
+void MosquitoPopulationAdaptor::save(checkpoint::Writer& out) const
+{
+    out.write(fractionalChange);
+}
 
+void MosquitoPopulationAdaptor::load(checkpoint::Reader& in)
+{
+    in.read(fractionalChange);
+}
@@ -5,12 +5,13 @@
 class OutputIntervalAdaptor : public Adaptor
 {
 private:
+    ParamManager& params;
     unsigned int tStart, tStop;
     std::string adaptorName;
     unsigned int targetValue;
     unsigned int baseValue; //Value to return to is always the base value used at the start of model initialisation.
 public:
-    OutputIntervalAdaptor(unsigned int tStart, unsigned int tStop, unsigned int targetValue);
+    OutputIntervalAdaptor(unsigned int tStart, unsigned int tStop, unsigned int targetValue, ParamManager& params);
     void update(unsigned int time);
     unsigned int get_start_t() const { return tStart; }
     unsigned int get_stop_t() const { return tStop; }
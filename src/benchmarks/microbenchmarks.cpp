@@ -0,0 +1,324 @@
+//Microbenchmarks of the model's core kernels (the Benchmark build target). Usage, as for the model, 'name value' pairs:
+//  microbenchmarks [repetitions 15] [warmup_seconds 0.2] [repetition_seconds 0.05] [filter substring] [output microbenchmarks.json] [model parameters...]
+//Any other pair sets a model parameter (e.g. num_phenotypes, repertoire_size), so kernels can be timed at the sizes of a real run.
+//Each benchmark is warmed up for warmup_seconds, which also sizes its batches so one repetition takes about repetition_seconds,
+//then timed over 'repetitions' batches. Results (ns per operation: min, median, mean, standard deviation, max) are printed and
+//written as JSON, so runs of different versions can be compared.
+#include "../diversity_monitor.hpp"
+#include "../host_population.hpp"
+#include "../infection.hpp"
+#include "../model_context.hpp"
+#include "../mosquito_population.hpp"
+#include "../strain.hpp"
+#include "../tool_options.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    unsigned int repetitions = 15;
+    double warmupSeconds = 0.2;
+    double repetitionSeconds = 0.05;
+    std::string filter = "";
+    std::string outputFile = "microbenchmarks.json";
+};
+
+struct Result
+{
+    std::string name;
+    std::string args;
+    uint64_t iterations; //Operations per repetition
+    std::vector<double> nsPerOp; //One per repetition
+};
+
+volatile uint64_t sink = 0; //Results are folded into this so the compiler can't drop the work being timed.
+
+double seconds_since(const Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Operation>
+double time_batch(Operation& op, const uint64_t n)
+{
+    const Clock::time_point start = Clock::now();
+    for (uint64_t i=0; i<n; ++i)
+        op();
+    return seconds_since(start);
+}
+
+//'op' performs one operation per call.
+template <typename Operation>
+void run(std::vector<Result>& results, const Options& options, const std::string& name, const std::string& args, Operation op)
+{
+    if (!options.filter.empty() && (name+" "+args).find(options.filter) == std::string::npos)
+        return;
+
+    //Warm up, doubling the batch until it is long enough to time reliably.
+    uint64_t batch = 1;
+    double batchSeconds = 0.0;
+    const Clock::time_point warmupStart = Clock::now();
+    while (true)
+    {
+        batchSeconds = time_batch(op, batch);
+        const bool longEnough = batchSeconds >= options.repetitionSeconds / 4;
+        if (longEnough && seconds_since(warmupStart) >= options.warmupSeconds)
+            break;
+        if (!longEnough)
+            batch *= 2;
+    }
+
+    Result result;
+    result.name = name;
+    result.args = args;
+    result.iterations = std::max<uint64_t>(1, (uint64_t)(batch * options.repetitionSeconds / batchSeconds));
+    for (unsigned int r=0; r<options.repetitions; ++r)
+        result.nsPerOp.push_back(1e9 * time_batch(op, result.iterations) / result.iterations);
+    results.push_back(result);
+
+    std::vector<double> sorted = result.nsPerOp;
+    std::sort(sorted.begin(), sorted.end());
+    std::cout << std::left << std::setw(46) << name << std::setw(28) << args << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << sorted[sorted.size()/2] << " ns (min " << sorted.front() << ", max " << sorted.back() << ")" << std::endl;
+}
+
+void write_json(const std::string& filename, const std::vector<Result>& results, const Options& options, const ParamManager& params)
+{
+    std::ofstream file;
+    file.open(filename, std::ofstream::out | std::ofstream::trunc);
+
+    const std::time_t now = std::time(nullptr);
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    file << "{\n  \"context\": {\"date\": \"" << date << "\", \"compiler\": \"" << __VERSION__ << "\", \"repetitions\": " << options.repetitions
+         << ", \"warmup_seconds\": " << options.warmupSeconds << ", \"repetition_seconds\": " << options.repetitionSeconds
+         << ", \"num_phenotypes\": " << params.num_phenotypes << ", \"repertoire_size\": " << params.repertoire_size
+         << ", \"num_hosts\": " << params.num_hosts << ", \"initial_num_mosquitoes\": " << params.initial_num_mosquitoes << "},\n";
+    file << "  \"benchmarks\": [";
+    file << std::setprecision(3) << std::fixed;
+    for (unsigned int i=0; i<results.size(); ++i)
+    {
+        const Result& result = results[i];
+        std::vector<double> sorted = result.nsPerOp;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (double ns : sorted)
+            mean += ns;
+        mean /= sorted.size();
+        double variance = 0.0;
+        for (double ns : sorted)
+            variance += (ns-mean)*(ns-mean);
+        variance /= std::max<size_t>(1, sorted.size()-1);
+        const double median = sorted.size() % 2 == 1 ? sorted[sorted.size()/2] : 0.5*(sorted[sorted.size()/2-1] + sorted[sorted.size()/2]);
+
+        file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.name << "\", \"args\": \"" << result.args << "\", \"iterations\": " << result.iterations
+             << ", \"repetitions\": " << sorted.size() << ", \"ns_per_op\": {\"min\": " << sorted.front() << ", \"median\": " << median
+             << ", \"mean\": " << mean << ", \"stddev\": " << std::sqrt(variance) << ", \"max\": " << sorted.back() << "}}";
+    }
+    file << "\n  ]\n}\n";
+    file.flush();
+    file.close();
+}
+
+Strain random_strain(ModelContext& ctx)
+{
+    Strain strain;
+    for (unsigned int i=0; i<ctx.params.repertoire_size; ++i)
+        strain.push_back(random_antigen(ctx));
+    return strain;
+}
+
+//Cycles through a pool of strains, so the kernels don't always see the same (cached) immune state entries.
+class StrainPool
+{
+private:
+    std::vector<Strain> strains;
+    unsigned int next = 0;
+public:
+    StrainPool(ModelContext& ctx, const unsigned int n) { for (unsigned int i=0; i<n; ++i) strains.push_back(random_strain(ctx)); }
+    const Strain& get() { next = (next+1) % strains.size(); return strains[next]; }
+    const Strain& get(const unsigned int i) const { return strains[i % strains.size()]; }
+    unsigned int size() const { return strains.size(); }
+};
+
+void benchmark_infection_kernels(std::vector<Result>& results, const Options& options, ModelContext& ctx, StrainPool& pool)
+{
+    utilities::RandomStream& rng = ctx.rng();
+    std::vector<float> immuneState(ctx.params.num_phenotypes);
+    for (float& immunity : immuneState)
+        immunity = rng.random_float01();
+
+    run(results, options, "duration_kernal", "", [&]() {
+        sink += duration_kernal(ctx.params, pool.get(), immuneState.data());
+    });
+
+    //The immunity mask (and so the work per antigen) grows with cross_immunity.
+    const float crossImmunity = ctx.params.cross_immunity;
+    const float crossImmunities[] = {0.0f, 0.5f, 1.0f, 2.0f, 4.0f};
+    for (float x : crossImmunities)
+    {
+        ctx.params.cross_immunity = x;
+        ctx.params.recalculate_derived_parameters();
+        std::ostringstream args;
+        args << "cross_immunity=" << x << " mask=" << ctx.params.get_immunity_mask().size();
+        run(results, options, "exposure_kernal", args.str(), [&]() {
+            exposure_kernal(ctx.params, pool.get(), immuneState.data());
+            sink += immuneState[0] > 0.5f;
+        });
+    }
+    ctx.params.cross_immunity = crossImmunity;
+    ctx.params.recalculate_derived_parameters();
+}
+
+void benchmark_strain_functions(std::vector<Result>& results, const Options& options, ModelContext& ctx, StrainPool& pool)
+{
+    utilities::RandomStream& rng = ctx.rng();
+
+    std::ostringstream intragenicArgs, intergenicArgs;
+    intragenicArgs << "p=" << ctx.params.intragenic_recombination_p;
+    intergenicArgs << "p=" << ctx.params.intergenic_recombination_p;
+    run(results, options, "generate_recombinant_strain/intragenic", intragenicArgs.str(), [&]() {
+        sink += generate_recombinant_strain(ctx, pool.get())[0];
+    });
+    run(results, options, "generate_recombinant_strain/intergenic", intergenicArgs.str(), [&]() {
+        const Strain& parent1 = pool.get();
+        sink += generate_recombinant_strain(ctx, parent1, pool.get())[0];
+    });
+
+    run(results, options, "recombinant_antigen", "", [&]() {
+        const Strain& strain = pool.get();
+        sink += recombinant_antigen(ctx, strain[0], strain[rng.urandom(0, strain.size())]);
+    });
+
+    run(results, options, "strain_phenotype_str_ordered", "", [&]() {
+        sink += strain_phenotype_str_ordered(ctx.params, pool.get()).size();
+    });
+
+    std::vector<Antigen> phenotypes;
+    run(results, options, "strain_phenotype_hash", "", [&]() {
+        sink += strain_phenotype_hash(ctx.params, pool.get(), phenotypes).lo;
+    });
+}
+
+//Random bites on a population seeded like ModelDriver::initialise_model. Every bites-per-day bites the day is advanced (host
+//infections expire, mosquitoes age and become infectious), so the population stays near a steady state. That upkeep is included.
+void benchmark_feed(std::vector<Result>& results, const Options& options, ModelContext& ctx, StrainPool& pool)
+{
+    utilities::RandomStream& rng = ctx.rng();
+    HostPopulation hosts(ctx);
+    hosts.resize(ctx.params.num_hosts);
+    for (unsigned int h=0; h<hosts.size(); ++h)
+        hosts.kill(h);
+
+    MosquitoPopulation mosquitoes(ctx);
+    mosquitoes.allocate(ctx.params.initial_num_mosquitoes);
+    for (unsigned int m=0; m<ctx.params.initial_num_mosquitoes; ++m)
+        mosquitoes.add();
+    for (unsigned int i=0; i<ctx.params.initial_num_mosquito_infections && i<mosquitoes.size(); ++i)
+        mosquitoes.infect(rng.urandom(0, mosquitoes.size()), pool.get(i), false);
+
+    unsigned int day = 0;
+    unsigned int bitesToday = 0;
+    const unsigned int bitesPerDay = std::max(1u, (unsigned int)(ctx.params.bite_rate * mosquitoes.size()));
+    run(results, options, "MosquitoPopulation::feed", "", [&]() {
+        mosquitoes.feed(rng.urandom(0, mosquitoes.size()), hosts, rng.urandom(0, hosts.size()), nullptr, true);
+        if (++bitesToday == bitesPerDay) {
+            bitesToday = 0;
+            ++day;
+            hosts.expire_infections(day);
+            mosquitoes.set_day(day);
+            for (unsigned int b=0; b<mosquitoes.num_blocks(); ++b)
+                mosquitoes.age_block(b, ctx.tables->pDeathMosquitoes);
+        }
+    });
+    sink += day;
+}
+
+void benchmark_diversity_monitor(std::vector<Result>& results, const Options& options, ModelContext& ctx, StrainPool& pool)
+{
+    utilities::RandomStream& rng = ctx.rng();
+    DiversityMonitor& diversity = ctx.diversity;
+
+    //Gains and losses are paired so the counts stay put.
+    run(results, options, "DiversityMonitor::register_antigen_gain+loss", "", [&]() {
+        const Antigen phenotype = rng.urandom(0, ctx.params.num_phenotypes);
+        diversity.register_antigen_gain(phenotype);
+        diversity.register_antigen_loss(phenotype);
+    });
+
+    //Leave a population of strains registered, so the indices below are over realistic counts.
+    for (unsigned int i=0; i<pool.size(); ++i)
+        diversity.register_new_strain(pool.get(i));
+
+    run(results, options, "DiversityMonitor::register_new+lost_strain", "", [&]() {
+        const Strain& strain = pool.get();
+        diversity.register_new_strain(strain);
+        diversity.register_lost_strain(strain);
+    });
+
+    //calc_shannon_entropy was replaced by incrementally maintained indices, which these read.
+    run(results, options, "DiversityMonitor::get_shannon_entropy", "", [&]() {
+        sink += diversity.get_shannon_entropy() > 1.0f;
+    });
+    run(results, options, "DiversityMonitor::get_simpson_diversity", "", [&]() {
+        sink += diversity.get_simpson_diversity() > 0.5f;
+    });
+    run(results, options, "DiversityMonitor::get_chao1_richness", "", [&]() {
+        sink += diversity.get_chao1_richness() > 1.0f;
+    });
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    ModelContext ctx;
+    ctx.params.random_seed = 1;
+    for (const std::pair<std::string, std::string>& pair : tool_options::read_pairs(argc, argv, "microbenchmarks"))
+    {
+        const std::string& token = pair.first;
+        const std::string& value = pair.second;
+        if (token == "repetitions")
+            options.repetitions = std::max(1, std::stoi(value));
+        else if (token == "warmup_seconds")
+            options.warmupSeconds = std::stod(value);
+        else if (token == "repetition_seconds")
+            options.repetitionSeconds = std::stod(value);
+        else if (token == "filter")
+            options.filter = value;
+        else if (token == "output")
+            options.outputFile = value;
+        else
+            ctx.params.set_param(token, value);
+    }
+    ctx.params.recalculate_derived_parameters();
+    ctx.initialise_random();
+    ctx.initialise_tables();
+    ctx.diversity.reset();
+    ctx.distributions.reset();
+
+    StrainPool pool(ctx, 1024);
+    std::vector<Result> results;
+    benchmark_infection_kernels(results, options, ctx, pool);
+    benchmark_strain_functions(results, options, ctx, pool);
+    benchmark_feed(results, options, ctx, pool);
+    benchmark_diversity_monitor(results, options, ctx, pool);
+
+    write_json(options.outputFile, results, options, ctx.params);
+    std::cout << "Wrote " << results.size() << " results to " << options.outputFile << std::endl;
+    return 0;
+}
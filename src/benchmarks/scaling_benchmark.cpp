@@ -0,0 +1,245 @@
+//Strong / weak scaling benchmark over canonical scenarios (the Scaling build target). Usage, 'name value' pairs:
+//  scaling_benchmark [scenarios default,high_eir,hosts_1e5,large_phenotypes] [modes strong,weak] [threads 1,2,4,...] [days 500]
+//                    [scale 1.0] [output scaling.csv] [output_path ""] [model parameters...]
+//Each run is one model run with a fixed seed for 'days' days, in its own child process so its peak RSS can be measured (Linux / POSIX).
+//Strong scaling keeps the scenario's population fixed; weak scaling multiplies the host and mosquito numbers by threads / threads[0].
+//'scale' multiplies every scenario's population, e.g. for a quick check on a workstation. Other pairs set model parameters in every run.
+//Results go to a CSV with host-days per second (of the time loop), speedup and parallel efficiency against the first thread count,
+//and peak RSS. The model's own output files go to output_path, named scaling_<scenario>_<mode>_<threads>.
+#include "../model_context.hpp"
+#include "../model_driver.hpp"
+#include "../tool_options.hpp"
+#include "../utilities.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+struct Scenario
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;
+};
+
+//The populations here are per run before weak scaling. Immune state is num_hosts x num_phenotypes floats, which bounds both.
+std::vector<Scenario> canonical_scenarios()
+{
+    std::vector<Scenario> scenarios;
+    scenarios.push_back(Scenario{"default", {}});
+    scenarios.push_back(Scenario{"high_eir", {{"initial_num_mosquitoes", "32000"}, {"bite_rate", "0.3"}, {"initial_num_mosquito_infections", "4000"}}});
+    scenarios.push_back(Scenario{"hosts_1e5", {{"num_hosts", "100000"}, {"initial_num_mosquitoes", "100000"}, {"num_phenotypes", "2500"},
+                                               {"initial_antigen_diversity", "2500"}, {"initial_num_mosquito_infections", "6000"}}});
+    scenarios.push_back(Scenario{"large_phenotypes", {{"num_hosts", "2000"}, {"initial_num_mosquitoes", "2000"}, {"num_phenotypes", "200000"},
+                                                      {"initial_antigen_diversity", "20000"}}});
+    return scenarios;
+}
+
+struct Options
+{
+    std::vector<std::string> scenarios;
+    std::vector<std::string> modes = {"strong", "weak"};
+    std::vector<unsigned int> threads;
+    unsigned int days = 500;
+    double scale = 1.0;
+    std::string outputFile = "scaling.csv";
+    std::string outputPath = "";
+    std::vector<std::pair<std::string, std::string>> params; //Applied to every run, after the scenario's.
+};
+
+struct RunResult
+{
+    bool ok = false;
+    unsigned int numHosts = 0;
+    unsigned int numMosquitoes = 0;
+    unsigned int numPhenotypes = 0;
+    double seconds = 0.0;
+    double peakRssMb = 0.0;
+};
+
+//Sets up and runs the model. Called in the child process.
+void run_scenario(ModelContext& ctx, ModelDriver& model, const Scenario& scenario, const Options& options, const std::string& runName, const double populationScale)
+{
+    ctx.params.random_seed = 1;
+    for (const std::pair<std::string, std::string>& param : scenario.params)
+        ctx.params.set_param(param.first, param.second);
+    for (const std::pair<std::string, std::string>& param : options.params)
+        ctx.params.set_param(param.first, param.second);
+
+    ctx.params.run_time = options.days;
+    ctx.params.output_interval = options.days;
+    ctx.params.output_profile = false;
+    ctx.params.runName = runName;
+    ctx.params.filePath = options.outputPath;
+
+    ctx.params.num_hosts = std::max(1u, (unsigned int)(ctx.params.num_hosts * populationScale));
+    ctx.params.initial_num_mosquitoes = std::max(1u, (unsigned int)(ctx.params.initial_num_mosquitoes * populationScale));
+    ctx.params.initial_num_mosquito_infections = (unsigned int)(ctx.params.initial_num_mosquito_infections * populationScale);
+    ctx.params.max_num_mosquitoes = ctx.params.initial_num_mosquitoes;
+    ctx.params.recalculate_derived_parameters();
+
+    model.run_model();
+}
+
+//Runs one scenario in a child process with 'numThreads' threads. The child sends back its sizes and time loop seconds through a pipe.
+RunResult run_child(const Scenario& scenario, const Options& options, const std::string& mode, const unsigned int numThreads)
+{
+    RunResult result;
+    const double populationScale = options.scale * (mode == "weak" ? (double)numThreads / options.threads.front() : 1.0);
+    std::ostringstream runName;
+    runName << "scaling_" << scenario.name << "_" << mode << "_" << numThreads;
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        throw std::runtime_error("scaling_benchmark: pipe() failed.");
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid < 0)
+        throw std::runtime_error("scaling_benchmark: fork() failed.");
+
+    if (pid == 0)
+    {
+        //Child: the parent never starts an OpenMP team, so the child's is created fresh with the requested size.
+        close(fds[0]);
+        if (std::freopen("/dev/null", "w", stdout) == nullptr) //The model's progress output.
+            _exit(2);
+        int status = 0;
+        try {
+            utilities::set_num_threads(numThreads);
+            ModelContext ctx;
+            ModelDriver model(ctx);
+            run_scenario(ctx, model, scenario, options, runName.str(), populationScale);
+
+            std::ostringstream reply;
+            reply << ctx.params.num_hosts << " " << ctx.params.initial_num_mosquitoes << " " << ctx.params.num_phenotypes << " " << model.get_simulation_seconds() << "\n";
+            const std::string text = reply.str();
+            if (write(fds[1], text.data(), text.size()) != (ssize_t)text.size())
+                status = 3;
+        }
+        catch (const std::exception& e) {
+            std::cerr << runName.str() << ": " << e.what() << std::endl;
+            status = 1;
+        }
+        close(fds[1]);
+        _exit(status);
+    }
+
+    close(fds[1]);
+    std::string text;
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+        text.append(buffer, n);
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return result;
+
+    std::istringstream reply(text);
+    reply >> result.numHosts >> result.numMosquitoes >> result.numPhenotypes >> result.seconds;
+    result.ok = !reply.fail();
+    result.peakRssMb = usage.ru_maxrss / 1024.0; //ru_maxrss is in KiB on Linux.
+    return result;
+}
+
+void parse_options(int argc, char* argv[], Options& options)
+{
+    for (const Scenario& scenario : canonical_scenarios())
+        options.scenarios.push_back(scenario.name);
+    for (unsigned int t=1; t<utilities::max_threads(); t*=2)
+        options.threads.push_back(t);
+    options.threads.push_back(utilities::max_threads());
+
+    for (const std::pair<std::string, std::string>& pair : tool_options::read_pairs(argc, argv, "scaling_benchmark"))
+    {
+        const std::string& token = pair.first;
+        const std::string& value = pair.second;
+        if (token == "scenarios")
+            options.scenarios = tool_options::split(value);
+        else if (token == "modes")
+            options.modes = tool_options::split(value);
+        else if (token == "threads") {
+            options.threads.clear();
+            for (const std::string& t : tool_options::split(value))
+                options.threads.push_back(std::max(1, std::stoi(t)));
+        }
+        else if (token == "days")
+            options.days = std::stoi(value);
+        else if (token == "scale")
+            options.scale = std::stod(value);
+        else if (token == "output")
+            options.outputFile = value;
+        else if (token == "output_path")
+            options.outputPath = value;
+        else
+            options.params.push_back(std::make_pair(token, value));
+    }
+
+    if (options.threads.empty())
+        throw std::runtime_error("scaling_benchmark: no thread counts given.");
+    for (const std::string& mode : options.modes)
+    {
+        if (mode != "strong" && mode != "weak")
+            throw std::runtime_error("scaling_benchmark: unknown mode '" + mode + "' (expected strong or weak).");
+    }
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    parse_options(argc, argv, options);
+
+    const std::vector<Scenario> scenarios = canonical_scenarios();
+    std::ofstream file;
+    file.open(options.outputFile, std::ofstream::out | std::ofstream::trunc);
+    file << "scenario, mode, threads, num_hosts, num_mosquitoes, num_phenotypes, days, seconds, host_days_per_second, speedup, parallel_efficiency, peak_rss_mb\n";
+
+    for (const std::string& name : options.scenarios)
+    {
+        auto scenario = std::find_if(scenarios.begin(), scenarios.end(), [&name](const Scenario& s) { return s.name == name; });
+        if (scenario == scenarios.end())
+            throw std::runtime_error("scaling_benchmark: unknown scenario '" + name + "'.");
+
+        for (const std::string& mode : options.modes)
+        {
+            //Speedup is in host-days per second, so it is comparable between strong and weak scaling.
+            double baseRate = 0.0;
+            for (unsigned int numThreads : options.threads)
+            {
+                std::cout << name << " " << mode << " " << numThreads << " threads: " << std::flush;
+                const RunResult result = run_child(*scenario, options, mode, numThreads);
+                if (!result.ok) {
+                    std::cout << "FAILED" << std::endl;
+                    file << name << ", " << mode << ", " << numThreads << ", , , , " << options.days << ", , , , , \n";
+                    continue;
+                }
+
+                const unsigned int daysSimulated = options.days + 1; //Day 0 to run_time inclusive.
+                const double rate = (double)result.numHosts * daysSimulated / result.seconds;
+                if (baseRate == 0.0)
+                    baseRate = rate;
+                const double speedup = rate / baseRate;
+                const double efficiency = speedup * options.threads.front() / numThreads;
+
+                std::cout << result.seconds << "s, " << rate << " host-days/s, efficiency " << efficiency << ", peak RSS " << result.peakRssMb << " MB" << std::endl;
+                file << name << ", " << mode << ", " << numThreads << ", " << result.numHosts << ", " << result.numMosquitoes << ", " << result.numPhenotypes << ", "
+                     << daysSimulated << ", " << result.seconds << ", " << rate << ", " << speedup << ", " << efficiency << ", " << result.peakRssMb << "\n";
+                file.flush();
+            }
+        }
+    }
+    file.close();
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "branching.hpp"
+#include "model_context.hpp"
+#include "model_driver.hpp"
+#include "adaptors/mosquito_population_adaptor.hpp"
+#include "adaptors/bite_rate_adaptor.hpp"
+#include "adaptors/output_interval_adaptor.hpp"
+#include "adaptors/intragenic_recombination_p_adaptor.hpp"
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+//Parameters which are read as the model runs, so a scenario may change them at the branch.
+const std::set<std::string> BRANCHABLE_PARAMETERS = {
+    "run_time", "verbose", "output_interval", "reintroduction_interval", "mosquito_eip",
+    "bite_rate", "intergenic_recombination_p", "intragenic_recombination_p", "recombination_scale",
+    "infection_duration_scale", "infectivity_scale", "cross_immunity", "immunity_scale",
+    "audit_self_heal", "audit_budget", "checkpoint_interval"
+};
+}
+
+std::vector<BranchScenario> branching::read_scenarios(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+        throw std::runtime_error("branching::read_scenarios: could not open scenario_file '" + filename + "'.");
+
+    std::vector<BranchScenario> scenarios;
+    std::set<std::string> names;
+    std::string line;
+    for (unsigned int lineNumber=1; std::getline(file, line); ++lineNumber)
+    {
+        std::istringstream tokens(line);
+        BranchScenario scenario;
+        if (!(tokens >> scenario.name) || scenario.name[0] == '#')
+            continue;
+
+        std::string token, value;
+        while (tokens >> token)
+        {
+            if (!(tokens >> value))
+                throw std::runtime_error("branching::read_scenarios: " + filename + ":" + std::to_string(lineNumber) + ": '" + token + "' has no value.");
+            scenario.settings.push_back(std::make_pair(token, value));
+        }
+
+        if (!names.insert(scenario.name).second)
+            throw std::runtime_error("branching::read_scenarios: " + filename + ":" + std::to_string(lineNumber) + ": scenario '" + scenario.name + "' is listed twice.");
+        check(scenario);
+        scenarios.push_back(scenario);
+    }
+
+    if (scenarios.empty())
+        throw std::runtime_error("branching::read_scenarios: scenario_file '" + filename + "' lists no scenarios.");
+    return scenarios;
+}
+
+void branching::check(const BranchScenario& scenario)
+{
+    //Applied to a throwaway model so that bad values and overlapping adaptors are found before the burn-in rather than after it.
+    ModelContext ctx;
+    ModelDriver model(ctx);
+    for (const std::pair<std::string, std::string>& setting : scenario.settings)
+    {
+        if (setting.first.find("adaptor") == std::string::npos && BRANCHABLE_PARAMETERS.count(setting.first) == 0)
+            throw std::runtime_error("branching::check: scenario '" + scenario.name + "' sets '" + setting.first + "', which can't differ between scenarios branched from one burn-in.");
+        try {
+            apply_setting(setting.first, setting.second, ctx, model);
+        }
+        catch (const std::logic_error&) { //std::stoi / std::stof
+            throw std::runtime_error("branching::check: scenario '" + scenario.name + "' has a bad value for '" + setting.first + "': '" + setting.second + "'.");
+        }
+    }
+    ctx.params.recalculate_derived_parameters();
+}
+
+void branching::apply_setting(const std::string& token, const std::string& value, ModelContext& ctx, ModelDriver& model)
+{
+    if (token.find("adaptor") == std::string::npos) {
+        ctx.params.set_param(token, value); //Throws exception if token doesn't name an existing parameter.
+        return;
+    }
+
+    const char delim = '+';
+
+    std::stringstream ss;
+    ss.str(value);
+    std::string curItem;
+
+    //Parse start time.
+    std::getline(ss, curItem, delim);
+    unsigned int tStart = std::stoi(curItem);
+
+    //Parse stop time.
+    std::getline(ss, curItem, delim);
+    unsigned int tStop = std::stoi(curItem);
+
+    //Load target value into curItem but don't make any assumptions about the type until we know the adaptor type.
+    std::getline(ss, curItem, delim);
+
+    //Create the adaptor based on the token.
+    if (token.find("mosquito_population_adaptor") != std::string::npos) {
+        unsigned int targetPopulation = std::stoi(curItem);
+        ctx.params.add_adaptor(new MosquitoPopulationAdaptor(tStart, tStop, targetPopulation, model.get_mos_manager(), ctx.params));
+        std::cout << "Added mosquito_population_adaptor.\n";
+    }
+    else if (token.find("bite_rate_adaptor") != std::string::npos) {
+        float targetBiteRate = std::stof(curItem);
+        ctx.params.add_adaptor(new BiteRateAdaptor(tStart, tStop, targetBiteRate, ctx.params));
+        std::cout << "Added bite_rate_adaptor.\n";
+    }
+    else if (token.find("intragenic_recombination_p_adaptor") != std::string::npos) {
+        float targetIntragenicRecombinationP = std::stof(curItem);
+        ctx.params.add_adaptor(new IntragenicRecombinationPAdaptor(tStart, tStop, targetIntragenicRecombinationP, ctx.params));
+        std::cout << "Added intragenic_recombination_p_adaptor.\n";
+    }
+    else if (token.find("output_interval_adaptor") != std::string::npos) {
+        unsigned int targetOutputInterval = std::stoi(curItem);
+        ctx.params.add_adaptor(new OutputIntervalAdaptor(tStart, tStop, targetOutputInterval, ctx.params));
+        std::cout << "Added output_interval_adaptor.\n";
+    }
+    else
+        throw std::runtime_error("branching::apply_setting: unknown adaptor '" + token + "'.");
+}
+
+void branching::continue_file(std::ofstream& file, const std::string& from, const std::string& to)
+{
+    if (file.is_open())
+        file.close();
+    copy_file(from, to);
+    file.open(to, std::ofstream::out | std::ofstream::app);
+}
+
+void branching::copy_file(const std::string& from, const std::string& to)
+{
+    std::ifstream source(from, std::ifstream::binary);
+    if (!source.is_open())
+        throw std::runtime_error("branching::copy_file: could not open '" + from + "'.");
+    std::ofstream dest(to, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    if (source.peek() != std::ifstream::traits_type::eof()) //Streaming an empty rdbuf sets failbit.
+        dest << source.rdbuf();
+    dest.close();
+    if (dest.fail())
+        throw std::runtime_error("branching::copy_file: could not write '" + to + "'.");
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ModelContext;
+class ModelDriver;
+
+//Scenario branching (scenario_file): the burn-in is run once, then ModelDriver::run_scenarios forks one process per scenario. fork()
+//shares the whole model state copy-on-write, so each scenario starts from the end of the burn-in for the cost of the pages it changes.
+//A scenario applies its own parameters and adaptors and then carries on to run_time, writing its output as runName_scenarioName (its
+//files written as the run goes, and its output series, start with the burn-in's).
+//Scenarios carry on from the burn-in's random number stream, so they all see the same random numbers (common random numbers): the
+//differences between them come from their settings rather than noise.
+//GNU OpenMP can't start a team of more than one thread in a process forked from one which has run a team, so each scenario runs on a
+//single thread and scenarios run side by side instead (max_concurrent_scenarios).
+struct BranchScenario
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> settings; //Token value pairs, as given on the command line.
+};
+
+namespace branching
+{
+    //One scenario per line: its name, then token value pairs separated by whitespace. Blank lines and lines starting with '#' are skipped.
+    //Throws std::runtime_error if the file can't be read, a line is malformed, a name is repeated or a scenario fails check().
+    std::vector<BranchScenario> read_scenarios(const std::string& filename);
+
+    //Throws std::runtime_error unless every setting is an adaptor, or a parameter which only affects the model from the day it is set
+    //(anything else fixes the shape of the model state or output, or is only used while initialising), and every value parses.
+    void check(const BranchScenario& scenario);
+
+    //Sets a parameter, or adds an adaptor if the token contains "adaptor" (value "start+stop+target"), from a command line token value pair.
+    void apply_setting(const std::string& token, const std::string& value, ModelContext& ctx, ModelDriver& model);
+
+    //Continues a file written as the run goes under a scenario's name: copies the burn-in's file 'from' to 'to' and opens 'to' for
+    //appending. The burn-in must have closed 'file' before forking, or the child would flush the burn-in's buffered output again.
+    void continue_file(std::ofstream& file, const std::string& from, const std::string& to);
+
+    void copy_file(const std::string& from, const std::string& to); //Throws std::runtime_error if 'from' can't be read or 'to' written.
+}
@@ -0,0 +1,118 @@
+#include "checkpoint.hpp"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+const char MAGIC[8] = {'T', 'D', 'M', 'C', 'K', 'P', 0, 1};
+}
+
+namespace checkpoint
+{
+void Writer::open(const std::string& _filename)
+{
+    filename = _filename;
+    file.open(filename + ".tmp", std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    if (!file.is_open())
+        throw std::runtime_error("checkpoint::Writer: could not open '" + filename + ".tmp'.");
+    file.write(MAGIC, sizeof(MAGIC));
+}
+
+void Writer::close()
+{
+    file.close();
+    if (file.fail())
+        throw std::runtime_error("checkpoint::Writer: failed writing '" + filename + ".tmp'.");
+    if (std::rename((filename + ".tmp").c_str(), filename.c_str()) != 0)
+        throw std::runtime_error("checkpoint::Writer: could not rename '" + filename + ".tmp' to '" + filename + "'.");
+}
+
+void Writer::section(const char* tag)
+{
+    file.write(tag, 4);
+}
+
+void Writer::write_string(const std::string& s)
+{
+    write<uint64_t>(s.size());
+    file.write(s.data(), s.size());
+}
+
+
+Reader::Reader(const std::string& _filename) : filename(_filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("checkpoint::Reader: could not open '" + filename + "'.");
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(MAGIC)) {
+        ::close(fd);
+        throw std::runtime_error("checkpoint::Reader: '" + filename + "' is not a checkpoint.");
+    }
+
+    size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); //The mapping keeps the file open.
+    if (mapped == MAP_FAILED)
+        throw std::runtime_error("checkpoint::Reader: could not map '" + filename + "'.");
+    data = static_cast<const char*>(mapped);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    if (std::memcmp(take(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0) {
+        munmap(const_cast<char*>(data), size);
+        throw std::runtime_error("checkpoint::Reader: '" + filename + "' is not a checkpoint (or is a different version).");
+    }
+}
+
+Reader::~Reader()
+{
+    munmap(const_cast<char*>(data), size);
+}
+
+const char* Reader::take(const uint64_t bytes)
+{
+    if (bytes > size - offset)
+        throw std::runtime_error("checkpoint::Reader: '" + filename + "' ends early (truncated, or written by a different build).");
+    const char* start = data + offset;
+    offset += bytes;
+    return start;
+}
+
+void Reader::section(const char* tag)
+{
+    const uint64_t at = offset;
+    if (std::memcmp(take(4), tag, 4) != 0)
+        throw std::runtime_error("checkpoint::Reader: expected section '" + std::string(tag, 4) + "' at byte " + std::to_string(at) + " of '" + filename + "' (written by a different build, or with different output options?).");
+}
+
+std::string Reader::read_string()
+{
+    const uint64_t length = read<uint64_t>();
+    return std::string(take(length), length);
+}
+
+
+uint64_t file_length(std::ofstream& file)
+{
+    if (!file.is_open())
+        return 0;
+    file.flush();
+    return file.tellp();
+}
+
+void reopen(std::ofstream& file, const std::string& filename, const uint64_t length)
+{
+    if (file.is_open())
+        file.close();
+    if (length == 0) { //Nothing had been written (or the file wasn't being written) when the checkpoint was saved.
+        file.open(filename, std::ofstream::out | std::ofstream::trunc);
+        return;
+    }
+    if (truncate(filename.c_str(), length) != 0)
+        throw std::runtime_error("checkpoint::reopen: could not cut '" + filename + "' back to its length at the checkpoint (missing?).");
+    file.open(filename, std::ofstream::out | std::ofstream::app);
+}
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//Binary checkpoint of a model run (checkpoint_interval / resume_from, see ModelDriver::save_checkpoint).
+//A checkpoint is the magic "TDMCKP" 0 1 (last byte is the format version) followed by sections, each a char[4] tag and then whatever
+//its owner wrote: plain values are written as their bytes, vectors as a uint64 length and then the elements. Each class saves and
+//loads its own state, in the same order, so a section tag that isn't where it is expected means the file doesn't match this build.
+//The file is written to filename.tmp and renamed when complete, so a run killed while checkpointing leaves the previous checkpoint intact.
+//The reader memory maps the file, so loading costs little more than copying the state into place.
+namespace checkpoint
+{
+    class Writer
+    {
+    private:
+        std::ofstream file;
+        std::string filename;
+
+    public:
+        void open(const std::string& _filename);
+        void close(); //Completes the checkpoint (replacing any earlier one). Throws std::runtime_error if anything failed to write.
+
+        void section(const char* tag); //4 characters
+
+        template <typename T>
+        void write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "checkpoint::Writer::write: only plain values can be written directly.");
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void write_array(const T* data, const uint64_t n)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "checkpoint::Writer::write_array: only plain values can be written directly.");
+            file.write(reinterpret_cast<const char*>(data), n*sizeof(T));
+        }
+
+        template <typename T>
+        void write_vector(const std::vector<T>& v)
+        {
+            write<uint64_t>(v.size());
+            write_array(v.data(), v.size());
+        }
+
+        template <typename T>
+        void write_vectors(const std::vector<std::vector<T>>& vs) //e.g. strains
+        {
+            write<uint64_t>(vs.size());
+            for (const std::vector<T>& v : vs)
+                write_vector(v);
+        }
+
+        void write_string(const std::string& s);
+    };
+
+    class Reader
+    {
+    private:
+        std::string filename;
+        const char* data = nullptr;
+        uint64_t size = 0;
+        uint64_t offset = 0;
+
+    public:
+        Reader(const std::string& _filename); //Throws std::runtime_error if the file can't be mapped or isn't a checkpoint.
+        ~Reader();
+        Reader(const Reader&) = delete;
+        void operator=(const Reader&) = delete;
+
+        void section(const char* tag); //Throws std::runtime_error unless the next section is 'tag'.
+        bool at_end() const { return offset == size; }
+
+        //Advances past the next 'bytes' bytes and returns where they start, in the mapping (valid while the Reader exists). For copying
+        //large arrays into place in parallel. Throws std::runtime_error if the file is too short.
+        const char* take(const uint64_t bytes);
+
+        template <typename T>
+        T read()
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "checkpoint::Reader::read: only plain values can be read directly.");
+            T value;
+            std::memcpy(&value, take(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        template <typename T>
+        void read(T& value) { value = read<T>(); }
+
+        template <typename T>
+        void read_array(T* dest, const uint64_t n)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "checkpoint::Reader::read_array: only plain values can be read directly.");
+            if (n != 0)
+                std::memcpy(dest, take(n*sizeof(T)), n*sizeof(T));
+        }
+
+        template <typename T>
+        void read_vector(std::vector<T>& v)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "checkpoint::Reader::read_vector: only plain values can be read directly.");
+            const uint64_t n = read<uint64_t>();
+            const char* source = take(n*sizeof(T)); //Checks the length before allocating.
+            v.resize(n);
+            if (n != 0)
+                std::memcpy(v.data(), source, n*sizeof(T));
+        }
+
+        template <typename T>
+        void read_vectors(std::vector<std::vector<T>>& vs)
+        {
+            vs.resize(read<uint64_t>());
+            for (std::vector<T>& v : vs)
+                read_vector(v);
+        }
+
+        std::string read_string();
+
+        //Throws std::runtime_error (naming 'what') unless the checkpoint's value equals 'expected'. For values that fix the shape of the state.
+        template <typename T>
+        void expect(const T& expected, const std::string& what)
+        {
+            const T value = read<T>();
+            if (!(value == expected))
+                throw std::runtime_error("checkpoint::Reader: '" + filename + "' was written with a different " + what + " (" + std::to_string(value) + ", not " + std::to_string(expected) + ").");
+        }
+    };
+
+    //Flushes a text file written as the run goes and returns its length, to be saved in a checkpoint.
+    uint64_t file_length(std::ofstream& file);
+
+    //Reopens a file written as the run goes for appending, cut back to the length it had when the checkpoint was saved. A length of 0
+    //starts the file afresh.
+    void reopen(std::ofstream& file, const std::string& filename, const uint64_t length);
+}
@@ -0,0 +1,241 @@
+#include "columnar_file.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const char MAGIC[8] = {'T', 'D', 'M', 'C', 'O', 'L', 0, 1};
+    const char CHUNK_TAG[4] = {'C', 'H', 'N', 'K'};
+
+    uint64_t padded(const uint64_t offset) { return (offset + 7) & ~(uint64_t)7; }
+
+    template <typename T>
+    void write_value(std::ofstream& file, const T value) { file.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    template <typename T>
+    T read_value(const std::vector<char>& data, uint64_t& offset)
+    {
+        if (offset + sizeof(T) > data.size())
+            throw std::runtime_error("columnar::Reader: file is truncated.");
+        T value;
+        std::memcpy(&value, &data[offset], sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    std::string read_string(const std::vector<char>& data, uint64_t& offset)
+    {
+        uint32_t length = read_value<uint32_t>(data, offset);
+        if (offset + length > data.size())
+            throw std::runtime_error("columnar::Reader: file is truncated.");
+        std::string str(&data[offset], length);
+        offset += length;
+        return str;
+    }
+}
+
+namespace columnar
+{
+
+const char* dtype_string(const Type type)
+{
+    switch (type)
+    {
+    case Type::UINT32:
+        return "<u4";
+    case Type::FLOAT32:
+        return "<f4";
+    }
+    return "";
+}
+
+static Type type_from_dtype_string(const std::string& dtype)
+{
+    if (dtype == "<u4")
+        return Type::UINT32;
+    else if (dtype == "<f4")
+        return Type::FLOAT32;
+    else
+        throw std::runtime_error("columnar::Reader: unsupported column type '" + dtype + "'.");
+}
+
+void Writer::open(const std::string& filename, const std::string& headerText)
+{
+    file.open(filename, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    if (!file.is_open())
+        throw std::runtime_error("columnar::Writer: could not open '" + filename + "'.");
+    header = headerText;
+    columns.clear();
+    schemaWritten = false;
+}
+
+unsigned int Writer::add_column(const std::string& name, const Type type, const uint32_t width)
+{
+    if (schemaWritten)
+        throw std::runtime_error("columnar::Writer: cannot add column '" + name + "' after data has been written.");
+    columns.push_back(Column{name, type, width});
+    return columns.size()-1;
+}
+
+//Pads the file with zeros to the next 8 byte boundary.
+void Writer::pad()
+{
+    static const char zeros[8] = {0};
+    uint64_t offset = file.tellp();
+    file.write(zeros, padded(offset) - offset);
+}
+
+void Writer::write_schema()
+{
+    file.write(MAGIC, sizeof(MAGIC));
+    write_value<uint32_t>(file, header.size());
+    file.write(header.data(), header.size());
+    pad();
+
+    write_value<uint32_t>(file, columns.size());
+    for (const Column& column : columns)
+    {
+        write_value<uint32_t>(file, column.name.size());
+        file.write(column.name.data(), column.name.size());
+        char dtype[4] = {0};
+        std::memcpy(dtype, dtype_string(column.type), 3);
+        file.write(dtype, 4);
+        write_value<uint32_t>(file, column.width);
+    }
+    pad();
+    schemaWritten = true;
+}
+
+void Writer::append(const unsigned int column, const uint32_t* data, const uint64_t rows)
+{
+    if (columns.at(column).type != Type::UINT32)
+        throw std::runtime_error("columnar::Writer: column '" + columns[column].name + "' is not uint32.");
+    if (!schemaWritten)
+        write_schema();
+
+    file.write(CHUNK_TAG, sizeof(CHUNK_TAG));
+    write_value<uint32_t>(file, column);
+    write_value<uint64_t>(file, rows);
+    file.write(reinterpret_cast<const char*>(data), rows*columns[column].width*sizeof(uint32_t));
+    pad();
+}
+
+void Writer::append(const unsigned int column, const float* data, const uint64_t rows)
+{
+    if (columns.at(column).type != Type::FLOAT32)
+        throw std::runtime_error("columnar::Writer: column '" + columns[column].name + "' is not float32.");
+    if (!schemaWritten)
+        write_schema();
+
+    file.write(CHUNK_TAG, sizeof(CHUNK_TAG));
+    write_value<uint32_t>(file, column);
+    write_value<uint64_t>(file, rows);
+    file.write(reinterpret_cast<const char*>(data), rows*columns[column].width*sizeof(float));
+    pad();
+}
+
+void Writer::append_rows(const unsigned int column, const std::vector<std::vector<uint32_t>>& rows)
+{
+    if (columns.at(column).type != Type::UINT32)
+        throw std::runtime_error("columnar::Writer: column '" + columns[column].name + "' is not uint32.");
+    if (!schemaWritten)
+        write_schema();
+
+    const uint32_t width = columns[column].width;
+    file.write(CHUNK_TAG, sizeof(CHUNK_TAG));
+    write_value<uint32_t>(file, column);
+    write_value<uint64_t>(file, rows.size());
+    for (const std::vector<uint32_t>& row : rows)
+    {
+        const uint32_t n = std::min<uint64_t>(row.size(), width);
+        file.write(reinterpret_cast<const char*>(row.data()), n*sizeof(uint32_t));
+        for (uint32_t i=n; i<width; ++i)
+            write_value<uint32_t>(file, 0);
+    }
+    pad();
+}
+
+void Writer::close()
+{
+    if (!file.is_open())
+        return;
+    if (!schemaWritten) //No data, but still a valid file.
+        write_schema();
+    file.close();
+}
+
+
+Reader::Reader(const std::string& filename)
+{
+    std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+    if (!file.is_open())
+        throw std::runtime_error("columnar::Reader: could not open '" + filename + "'.");
+    file.seekg(0, std::ifstream::end);
+    data.resize(file.tellg());
+    file.seekg(0);
+    file.read(data.data(), data.size());
+
+    if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error("columnar::Reader: '" + filename + "' is not a columnar output file (or is a different version).");
+
+    uint64_t offset = sizeof(MAGIC);
+    header = read_string(data, offset);
+    offset = padded(offset);
+
+    uint32_t numColumns = read_value<uint32_t>(data, offset);
+    for (uint32_t c=0; c<numColumns; ++c)
+    {
+        Column column;
+        column.name = read_string(data, offset);
+        char dtype[4];
+        for (unsigned int i=0; i<4; ++i)
+            dtype[i] = read_value<char>(data, offset);
+        column.type = type_from_dtype_string(std::string(dtype, 3));
+        column.width = read_value<uint32_t>(data, offset);
+        columns.push_back(column);
+    }
+    offset = padded(offset);
+
+    //Index the chunks. A partly written final chunk (e.g. from a killed run) is ignored.
+    chunks.resize(columns.size());
+    while (offset + 16 <= data.size())
+    {
+        if (std::memcmp(&data[offset], CHUNK_TAG, sizeof(CHUNK_TAG)) != 0)
+            throw std::runtime_error("columnar::Reader: corrupt chunk in '" + filename + "'.");
+        offset += sizeof(CHUNK_TAG);
+        uint32_t column = read_value<uint32_t>(data, offset);
+        uint64_t rows = read_value<uint64_t>(data, offset);
+        if (column >= columns.size())
+            throw std::runtime_error("columnar::Reader: chunk for unknown column in '" + filename + "'.");
+
+        uint64_t bytes = rows * columns[column].width * 4; //Every supported type is 4 bytes.
+        if (offset + bytes > data.size())
+            break;
+        chunks[column].push_back(Chunk{offset, rows});
+        offset = padded(offset + bytes);
+    }
+}
+
+int Reader::find_column(const std::string& name) const
+{
+    for (unsigned int c=0; c<columns.size(); ++c)
+    {
+        if (columns[c].name == name)
+            return c;
+    }
+    return -1;
+}
+
+uint64_t Reader::num_rows(const std::string& name) const
+{
+    int c = find_column(name);
+    if (c < 0)
+        throw std::runtime_error("columnar::Reader: no column named '" + name + "'.");
+
+    uint64_t rows = 0;
+    for (const Chunk& chunk : chunks[c])
+        rows += chunk.rows;
+    return rows;
+}
+
+}
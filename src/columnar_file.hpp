@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Single file, chunked, columnar binary container for a run's output (output_format binary).
+//All integers are little endian and every section starts on an 8 byte boundary, so columns can be memory mapped in place
+//(see read_columnar_output.py for the numpy reader).
+//
+//  char[8]   magic "TDMCOL" 0 1 (last byte is the format version)
+//  uint32    header length, then the header text (the run's calling arguments, "name value" per line)
+//  uint32    number of columns, then for each column:
+//              uint32 name length, name, char[4] numpy dtype string ("<u4" / "<f4" + 0), uint32 width (values per row)
+//  chunks, until end of file:
+//              char[4] "CHNK", uint32 column index, uint64 number of rows, rows*width values
+//
+//A column's data is the concatenation of its chunks in file order, so data can be appended a chunk at a time as a run goes.
+namespace columnar
+{
+    enum class Type : uint8_t { UINT32, FLOAT32 };
+
+    const char* dtype_string(const Type type); //numpy dtype string, e.g. "<f4"
+
+    struct Column
+    {
+        std::string name;
+        Type type;
+        uint32_t width;
+    };
+
+    class Writer
+    {
+    private:
+        std::ofstream file;
+        std::string header;
+        std::vector<Column> columns;
+        bool schemaWritten = false;
+
+        void pad();
+        void write_schema();
+
+    public:
+        void open(const std::string& filename, const std::string& headerText);
+        unsigned int add_column(const std::string& name, const Type type, const uint32_t width = 1); //Returns the column index.
+
+        //Appends a chunk of rows*width values. All columns must be added before the first chunk is appended.
+        void append(const unsigned int column, const uint32_t* data, const uint64_t rows);
+        void append(const unsigned int column, const float* data, const uint64_t rows);
+        void append(const unsigned int column, const std::vector<uint32_t>& data) { append(column, data.data(), data.size()/columns.at(column).width); }
+        void append(const unsigned int column, const std::vector<float>& data) { append(column, data.data(), data.size()/columns.at(column).width); }
+
+        void append_rows(const unsigned int column, const std::vector<std::vector<uint32_t>>& rows); //One chunk. Short rows are padded with 0.
+
+        void flush() { file.flush(); }
+        void close();
+        bool is_open() const { return file.is_open(); }
+    };
+
+    class Reader
+    {
+    private:
+        struct Chunk { uint64_t offset; uint64_t rows; };
+
+        std::vector<char> data;
+        std::string header;
+        std::vector<Column> columns;
+        std::vector<std::vector<Chunk>> chunks; //Per column.
+
+        template <typename T>
+        std::vector<T> read_column(const std::string& name, const Type type) const;
+
+    public:
+        Reader(const std::string& filename); //Reads and indexes the whole file. Throws std::runtime_error if it isn't valid.
+
+        const std::string& get_header() const { return header; }
+        const std::vector<Column>& get_columns() const { return columns; }
+        int find_column(const std::string& name) const; //-1 if there is no such column.
+        uint64_t num_rows(const std::string& name) const;
+
+        //Row major, num_rows(name) * width values. Throws if the column doesn't exist or has a different type.
+        std::vector<uint32_t> read_uint32(const std::string& name) const { return read_column<uint32_t>(name, Type::UINT32); }
+        std::vector<float> read_float32(const std::string& name) const { return read_column<float>(name, Type::FLOAT32); }
+    };
+
+    template <typename T>
+    std::vector<T> Reader::read_column(const std::string& name, const Type type) const
+    {
+        int c = find_column(name);
+        if (c < 0)
+            throw std::runtime_error("columnar::Reader: no column named '" + name + "'.");
+        if (columns[c].type != type)
+            throw std::runtime_error("columnar::Reader: column '" + name + "' has type " + dtype_string(columns[c].type) + ".");
+
+        std::vector<T> values;
+        values.reserve(num_rows(name)*columns[c].width);
+        for (const Chunk& chunk : chunks[c])
+        {
+            const T* begin = reinterpret_cast<const T*>(&data[chunk.offset]);
+            values.insert(values.end(), begin, begin + chunk.rows*columns[c].width);
+        }
+        return values;
+    }
+}
@@ -1,63 +1,72 @@
 #include "demographic_tools.hpp"
-#include "utilities.hpp"
 #include "param_manager.hpp"
 #include <cmath>
 
-PTABLE generate_host_ptable()
+std::shared_ptr<const DemographicTables> generate_demographic_tables(const ParamManager& params)
+{
+    std::shared_ptr<DemographicTables> tables = std::make_shared<DemographicTables>();
+    tables->pDeathHosts = generate_host_ptable(params);
+    tables->pDeathMosquitoes = generate_mosquito_ptable(params);
+    tables->cdfHosts = calculate_host_cdf(params, tables->pDeathHosts);
+    tables->cdfMosquitoes = calculate_mosquito_cdf(params, tables->pDeathMosquitoes);
+    return tables;
+}
+
+PTABLE generate_host_ptable(const ParamManager& params)
 {
     PTABLE pDeath;
     float lambda = -0.0000015;
     for (unsigned int age=0; age<pDeath.size(); ++age)
         pDeath[age] = std::exp(-((float)age*lambda)) - 1.0;
-    utilities::arrayToFile(pDeath, ParamManager::file_path()+ParamManager::run_name()+"_host_pdeath.csv");
+    utilities::arrayToFile(pDeath, params.file_path()+params.run_name()+"_host_pdeath.csv");
     return pDeath;
 }
 
-PTABLE generate_mosquito_ptable()
+PTABLE generate_mosquito_ptable(const ParamManager& params)
 {
     PTABLE pDeath;
     for (unsigned int age=0; age<pDeath.size(); ++age)
-        pDeath[age] = 0.25 / (1.0+std::exp(-(0.5*((float)age - (float)ParamManager::mean_mosquito_life_expectancy))));
-    utilities::arrayToFile(pDeath, ParamManager::file_path()+ParamManager::run_name()+"_mosquito_pdeath.csv");
+        pDeath[age] = 0.25 / (1.0+std::exp(-(0.5*((float)age - (float)params.mean_mosquito_life_expectancy))));
+    utilities::arrayToFile(pDeath, params.file_path()+params.run_name()+"_mosquito_pdeath.csv");
     return pDeath;
 }
 
 //Returns cumulative density function for host pDeath tables (taking yearly format into account).
-PTABLE calculate_host_cdf(const PTABLE& pDeath)
+PTABLE calculate_host_cdf(const ParamManager& params, const PTABLE& pDeath)
 {
     PTABLE cdf;
     cdf[0] = std::pow(1.0-pDeath[0], 365);
     for (unsigned int i=1; i<pDeath.size(); ++i)
         cdf[i] = cdf[i-1] *= std::pow(((1.0 - pDeath[i])), 365);
-    utilities::arrayToFile(cdf, ParamManager::file_path()+ParamManager::run_name()+"_host_cdf.csv");
+    utilities::arrayToFile(cdf, params.file_path()+params.run_name()+"_host_cdf.csv");
     return cdf;
 }
 
 //Returns cumulative density function for mosquito pDeath tables (daily).
-PTABLE calculate_mosquito_cdf(const PTABLE& pDeath)
+PTABLE calculate_mosquito_cdf(const ParamManager& params, const PTABLE& pDeath)
 {
     PTABLE cdf;
     cdf[0] = 1.0-pDeath[0];
     for (unsigned int i=1; i<pDeath.size(); ++i)
         cdf[i] = (cdf[i-1] *= (1.0 - pDeath[i]));
-    utilities::arrayToFile(cdf, ParamManager::file_path()+ParamManager::run_name()+"_mosquito_cdf.csv");
+    utilities::arrayToFile(cdf, params.file_path()+params.run_name()+"_mosquito_cdf.csv");
     return cdf;
 }
 
-unsigned int random_host_equilibrum_age(const PTABLE& cdf)
+unsigned int random_host_equilibrum_age(utilities::RandomStream& rng, const PTABLE& cdf)
 {
-    float survivalP = utilities::random_float01();
+    float survivalP = rng.random_float01();
     unsigned int ageYears = 0;
     while (cdf[ageYears]>=survivalP)
         ++ageYears;
 
-    short ageDays = utilities::random(0, 365);
+    short ageDays = rng.random(0, 365);
     return (ageYears*365) + ageDays;
 }
 
-unsigned int random_mosquito_equilibrium_age(const PTABLE& cdf)
+unsigned int random_mosquito_equilibrium_age(utilities::RandomStream& rng, const PTABLE& cdf)
 {
-    float survivalP = utilities::random_float01();
+    float survivalP = rng.random_float01();
     unsigned int age = 0;
     while (cdf[age] >= survivalP)
         ++age;
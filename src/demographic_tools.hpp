@@ -1,15 +1,29 @@
 #pragma once
-#include "host.hpp"
-#include "mosquito.hpp"
+#include "global_typedefs.hpp"
+#include "utilities.hpp"
+#include <memory>
 
-PTABLE generate_host_ptable();
+class ParamManager;
 
-PTABLE generate_mosquito_ptable();
+//Demographic probability tables for one parameter set. Never modified once generated, so can be shared between model runs.
+struct DemographicTables
+{
+    PTABLE pDeathHosts;
+    PTABLE pDeathMosquitoes;
+    PTABLE cdfHosts;
+    PTABLE cdfMosquitoes;
+};
 
-PTABLE calculate_host_cdf(const PTABLE& pDeath); //Returns cumulative density function for host pDeath tables (taking yearly format into account).
+std::shared_ptr<const DemographicTables> generate_demographic_tables(const ParamManager& params);
 
-PTABLE calculate_mosquito_cdf(const PTABLE& pDeath); //Returns cumulative density function for mosquito pDeath tables (daily).
+PTABLE generate_host_ptable(const ParamManager& params);
 
-unsigned int random_host_equilibrum_age(const PTABLE& cdf);
+PTABLE generate_mosquito_ptable(const ParamManager& params);
 
-unsigned int random_mosquito_equilibrium_age(const PTABLE& cdf);
+PTABLE calculate_host_cdf(const ParamManager& params, const PTABLE& pDeath); //Returns cumulative density function for host pDeath tables (taking yearly format into account).
+
+PTABLE calculate_mosquito_cdf(const ParamManager& params, const PTABLE& pDeath); //Returns cumulative density function for mosquito pDeath tables (daily).
+
+unsigned int random_host_equilibrum_age(utilities::RandomStream& rng, const PTABLE& cdf);
+
+unsigned int random_mosquito_equilibrium_age(utilities::RandomStream& rng, const PTABLE& cdf);
@@ -0,0 +1,55 @@
+#include "distribution_monitor.hpp"
+#include "checkpoint.hpp"
+#include "param_manager.hpp"
+#include "utilities.hpp"
+
+void DistributionMonitor::reset()
+{
+    threads.assign(utilities::max_threads(), ThreadSketches());
+}
+
+bool DistributionMonitor::enabled() const
+{
+    return params.output_distributions;
+}
+
+void DistributionMonitor::record_infection(const unsigned int duration, const unsigned int hostAge)
+{
+    ThreadSketches& sketches = threads[utilities::thread_num()];
+    sketches.infectionDurations.update(duration);
+    sketches.agesAtInfection.update(hostAge);
+}
+
+void DistributionMonitor::collect(QuantileSketch& durations, QuantileSketch& ages)
+{
+    for (ThreadSketches& sketches : threads)
+    {
+        durations.merge(sketches.infectionDurations);
+        ages.merge(sketches.agesAtInfection);
+        sketches.infectionDurations.clear();
+        sketches.agesAtInfection.clear();
+    }
+}
+
+void DistributionMonitor::save(checkpoint::Writer& out) const
+{
+    out.section("DIST");
+    out.write<uint64_t>(threads.size());
+    for (const ThreadSketches& sketches : threads)
+    {
+        sketches.infectionDurations.save(out);
+        sketches.agesAtInfection.save(out);
+    }
+}
+
+void DistributionMonitor::load(checkpoint::Reader& in)
+{
+    reset();
+    in.section("DIST");
+    in.expect<uint64_t>(threads.size(), "number of threads");
+    for (ThreadSketches& sketches : threads)
+    {
+        sketches.infectionDurations.load(in);
+        sketches.agesAtInfection.load(in);
+    }
+}
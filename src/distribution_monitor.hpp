@@ -0,0 +1,38 @@
+#pragma once
+#include "quantile_sketch.hpp"
+#include <vector>
+
+class ParamManager;
+namespace checkpoint { class Writer; class Reader; }
+
+//Distributions of per infection quantities over each output interval (output_distributions), kept as quantile sketches.
+//Each thread records into its own sketches, which Output merges at each output. One per model run (owned by ModelContext).
+class DistributionMonitor
+{
+private:
+    const ParamManager& params;
+
+    struct ThreadSketches
+    {
+        QuantileSketch infectionDurations;
+        QuantileSketch agesAtInfection;
+        char padding[64]; //Keeps adjacent threads' sketches (updated on every infection) on separate cache lines.
+    };
+    std::vector<ThreadSketches> threads;
+
+public:
+    DistributionMonitor(const ParamManager& params) : params(params) {  }
+    DistributionMonitor(const DistributionMonitor&) = delete;
+    void operator=(const DistributionMonitor&) = delete;
+
+    void reset();
+    bool enabled() const;
+
+    void record_infection(const unsigned int duration, const unsigned int hostAge); //Thread safe.
+
+    //Merges every thread's sketches into the arguments and clears them, ready for the next interval. Not thread safe.
+    void collect(QuantileSketch& durations, QuantileSketch& ages);
+
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in); //In place of reset().
+};
@@ -0,0 +1,208 @@
+#include "diversity_audit.hpp"
+#include "branching.hpp"
+#include "checkpoint.hpp"
+#include "host_population.hpp"
+#include "memory_report.hpp"
+#include "model_context.hpp"
+#include "mosquito_population.hpp"
+#include "strain.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void DiversityAudit::reset()
+{
+    start();
+    if (!enabled())
+        return;
+
+    file.open(filename(), std::ofstream::out | std::ofstream::trunc);
+    file << "day, seconds, mismatched_phenotypes, absolute_drift, counted_total, monitored_total, counted_unique, monitored_unique, healed\n";
+}
+
+void DiversityAudit::start()
+{
+    interval = ctx.params.audit_interval;
+    selfHeal = ctx.params.audit_self_heal;
+    budget = ctx.params.audit_budget;
+    nextDay = interval;
+    numAudits = 0;
+    numDrifted = 0;
+    auditSeconds = 0.0;
+    runStart = Clock::now();
+    runStartDay = 0;
+
+    if (file.is_open())
+        file.close();
+    threadCounts.clear();
+    counts.clear();
+    if (!enabled())
+        return;
+
+    threadCounts.assign(utilities::max_threads(), std::vector<unsigned int>(ctx.params.num_phenotypes, 0));
+    counts.assign(ctx.params.num_phenotypes, 0);
+    tallies.assign(utilities::max_threads(), ThreadTally());
+}
+
+std::string DiversityAudit::filename() const
+{
+    return ctx.params.file_path()+ctx.params.run_name()+"_diversity_audit.csv";
+}
+
+void DiversityAudit::audit(const unsigned int day, const HostPopulation& hosts, const MosquitoPopulation& mosquitoes)
+{
+    const unsigned int t = utilities::thread_num();
+    if (t == 0)
+        auditStart = Clock::now();
+    std::vector<unsigned int>& myCounts = threadCounts[t];
+    std::fill(myCounts.begin(), myCounts.end(), 0);
+    const ParamManager& params = ctx.params;
+
+    #pragma omp for schedule(static) nowait
+    for (unsigned int b=0; b<hosts.num_blocks(); ++b)
+    {
+        for (unsigned int h=hosts.block_begin(b); h<hosts.block_end(b); ++h)
+        {
+            for (unsigned int s=0; s<HostPopulation::NUM_INFECTION_SLOTS; ++s)
+            {
+                if (hosts.is_infected(h, s)) {
+                    for (const Antigen antigen : hosts.get_strain(h, s))
+                        ++myCounts[get_phenotype_id(params, antigen)];
+                }
+            }
+        }
+    }
+
+    #pragma omp for schedule(static)
+    for (unsigned int b=0; b<mosquitoes.num_blocks(); ++b)
+    {
+        for (unsigned int i=mosquitoes.block_begin(b); i<mosquitoes.block_end(b); ++i)
+        {
+            if (mosquitoes.is_infected(i)) {
+                for (const Antigen antigen : mosquitoes.get_strain(i))
+                    ++myCounts[get_phenotype_id(params, antigen)];
+            }
+        }
+    }
+
+    //Merge and compare, each thread taking a range of phenotypes.
+    ThreadTally& tally = tallies[t];
+    tally = ThreadTally();
+    const std::vector<unsigned int>& monitored = ctx.diversity.get_antigen_counts();
+    #pragma omp for schedule(static)
+    for (unsigned int p=0; p<counts.size(); ++p)
+    {
+        unsigned int count = 0;
+        for (const std::vector<unsigned int>& threadCount : threadCounts)
+            count += threadCount[p];
+        counts[p] = count;
+
+        tally.countedTotal += count;
+        tally.countedUnique += count != 0;
+        if (count != monitored[p]) {
+            ++tally.mismatched;
+            tally.absoluteDrift += count > monitored[p] ? count - monitored[p] : monitored[p] - count;
+        }
+    }
+
+    #pragma omp single
+    finish(day);
+}
+
+void DiversityAudit::finish(const unsigned int day)
+{
+    ThreadTally total = ThreadTally();
+    for (const ThreadTally& tally : tallies)
+    {
+        total.mismatched += tally.mismatched;
+        total.absoluteDrift += tally.absoluteDrift;
+        total.countedTotal += tally.countedTotal;
+        total.countedUnique += tally.countedUnique;
+    }
+
+    DiversityMonitor& diversity = ctx.diversity;
+    const unsigned int monitoredTotal = diversity.get_total_antigens();
+    const unsigned int monitoredUnique = diversity.get_num_unique_antigens();
+    const bool drifted = total.mismatched != 0 || total.countedTotal != monitoredTotal || total.countedUnique != monitoredUnique;
+    const bool healed = drifted && selfHeal;
+    if (healed)
+        diversity.rebuild(counts);
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - auditStart).count();
+    file << day << ", " << seconds << ", " << total.mismatched << ", " << total.absoluteDrift << ", " << total.countedTotal << ", "
+         << monitoredTotal << ", " << total.countedUnique << ", " << monitoredUnique << ", " << healed << "\n";
+    if (drifted) {
+        ++numDrifted;
+        std::cout << "DiversityAudit: t=" << day << " " << total.mismatched << " antigen counts drifted (total " << total.absoluteDrift
+                  << "; counted " << total.countedTotal << " vs " << monitoredTotal << " monitored)" << (healed ? ", rebuilt." : ".") << std::endl;
+    }
+
+    //Stay within budget: if the audits have cost more than 'budget' of the run so far, wait long enough for this one to be paid off.
+    ++numAudits;
+    auditSeconds += seconds;
+    unsigned int wait = interval;
+    const double elapsed = std::chrono::duration<double>(Clock::now() - runStart).count();
+    if (budget > 0.0f && auditSeconds > budget*elapsed && day > runStartDay) {
+        const double secondsPerDay = std::max(1e-9, (elapsed - auditSeconds) / (day - runStartDay));
+        wait = std::max<unsigned int>(interval, std::ceil(seconds / (budget*secondsPerDay)));
+    }
+    nextDay = day + wait;
+}
+
+void DiversityAudit::close()
+{
+    if (!file.is_open())
+        return;
+    file.close();
+    std::cout << "DiversityAudit: " << numAudits << " audits (" << auditSeconds << "s), " << numDrifted << " found drift." << std::endl;
+}
+
+uint64_t DiversityAudit::memory_bytes() const
+{
+    uint64_t bytes = memory::vector_bytes(threadCounts) + memory::vector_bytes(counts) + memory::vector_bytes(tallies);
+    for (const std::vector<unsigned int>& threadCount : threadCounts)
+        bytes += memory::vector_bytes(threadCount);
+    return bytes;
+}
+
+void DiversityAudit::save(checkpoint::Writer& out)
+{
+    out.section("AUDT");
+    out.write(nextDay);
+    out.write(numAudits);
+    out.write(numDrifted);
+    out.write(checkpoint::file_length(file));
+}
+
+void DiversityAudit::load(checkpoint::Reader& in, const unsigned int day)
+{
+    in.section("AUDT");
+    const unsigned int savedNextDay = in.read<unsigned int>();
+    const unsigned int savedNumAudits = in.read<unsigned int>();
+    const unsigned int savedNumDrifted = in.read<unsigned int>();
+    const uint64_t length = in.read<uint64_t>();
+
+    if (length == 0) //Audits weren't on when the checkpoint was saved.
+        reset();
+    else
+        start();
+    runStartDay = day;
+    if (!enabled() || length == 0)
+        return;
+    nextDay = savedNextDay;
+    numAudits = savedNumAudits;
+    numDrifted = savedNumDrifted;
+    checkpoint::reopen(file, filename(), length);
+}
+
+void DiversityAudit::branch(const std::string& burnInPrefix, const unsigned int day)
+{
+    if (!enabled())
+        return;
+    selfHeal = ctx.params.audit_self_heal;
+    budget = ctx.params.audit_budget;
+    auditSeconds = 0.0;
+    runStart = Clock::now();
+    runStartDay = day;
+    branching::continue_file(file, burnInPrefix+"_diversity_audit.csv", filename());
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class ModelContext;
+class HostPopulation;
+class MosquitoPopulation;
+namespace checkpoint { class Writer; class Reader; }
+
+//Checks the DiversityMonitor's incrementally maintained antigen counts against a full recount of the live host and mosquito
+//infections (audit_interval). Each thread recounts its share of the population into its own count vector and the vectors are merged
+//in parallel, so an audit costs about as much as a day of ageing. Any drift is written to _diversity_audit.csv and printed, and with
+//audit_self_heal the monitor is rebuilt from the recount.
+//Audits are skipped to keep their total cost within audit_budget of the run's wall time: after each one the next is pushed back if
+//the audits so far have cost more than that.
+class DiversityAudit
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct ThreadTally
+    {
+        uint64_t mismatched;
+        uint64_t absoluteDrift;
+        uint64_t countedTotal;
+        uint64_t countedUnique;
+        char padding[64]; //Keeps adjacent threads' tallies on separate cache lines.
+    };
+
+    ModelContext& ctx;
+    unsigned int interval = 0;
+    bool selfHeal = false;
+    float budget = 0.0f;
+
+    unsigned int nextDay = 0;
+    unsigned int numAudits = 0;
+    unsigned int numDrifted = 0;
+    double auditSeconds = 0.0;
+    Clock::time_point runStart;
+    unsigned int runStartDay = 0;
+    Clock::time_point auditStart;
+
+    std::vector<std::vector<unsigned int>> threadCounts; //Per thread, num_phenotypes long.
+    std::vector<unsigned int> counts; //Merged recount.
+    std::vector<ThreadTally> tallies;
+    std::ofstream file;
+
+    void start(); //Everything reset() does except starting the log.
+    std::string filename() const;
+    void finish(const unsigned int day);
+
+public:
+    DiversityAudit(ModelContext& _ctx) : ctx(_ctx) {  }
+
+    void reset(); //Call at the start of a run, after the DiversityMonitor has been reset.
+    bool enabled() const { return interval != 0; }
+    bool is_due(const unsigned int day) const { return enabled() && day >= nextDay; }
+
+    //Recounts and compares. Must be called by every thread of the team when called from inside a parallel region, while no
+    //infections are being gained or lost.
+    void audit(const unsigned int day, const HostPopulation& hosts, const MosquitoPopulation& mosquitoes);
+    void close();
+    uint64_t memory_bytes() const;
+
+    void save(checkpoint::Writer& out);
+    void load(checkpoint::Reader& in, const unsigned int day); //In place of reset(), resuming on 'day'. The budget only counts time since then.
+
+    //Carries the burn-in's audits (log burnInPrefix_diversity_audit.csv) on in a scenario branched on 'day', see branching.hpp. Call once
+    //the scenario's parameters are set. The budget only counts time since the branch.
+    void branch(const std::string& burnInPrefix, const unsigned int day);
+};
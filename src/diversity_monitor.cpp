@@ -1,101 +1,228 @@
 #include "diversity_monitor.hpp"
+#include "checkpoint.hpp"
+#include "memory_report.hpp"
 #include "param_manager.hpp"
 #include "strain.hpp"
+#include <cmath>
 #include <iostream>
 
-DiversityMonitor::DiversityMonitor()
+const double DiversityMonitor::N_LOG_N_SCALE = 1048576.0;
+
+void DiversityMonitor::reset()
 {
-    //DiversityMonitor::reset(); Commented because constructor cannot rely on ParamManager. ParamManager calls DiversityManager::reset.
+    totalAntigens = 0;
+    uniqueAntigens = 0;
+    numExtinctions = 0;
+    numNewlyGenerated = 0;
+    antigenCounts = std::vector<unsigned int> (params.num_phenotypes , 0);
+
+    sumNLogN = 0;
+    sumPairs = 0;
+    numSingletons = 0;
+    numDoubletons = 0;
+    if (nLogNTable.empty()) {
+        nLogNTable.push_back(0);
+        for (unsigned int n=1; n<N_LOG_N_TABLE_SIZE; ++n)
+            nLogNTable.push_back(std::llround(n*std::log((double)n) * N_LOG_N_SCALE));
+    }
+    topAntigens.reset(params.output_top_antigens, params.num_phenotypes);
 }
 
-void DiversityMonitor::reset()
+int64_t DiversityMonitor::n_log_n(const unsigned int n) const
 {
-    instance().totalAntigens = 0;
-    instance().uniqueAntigens = 0;
-    instance().numExtinctions = 0;
-    instance().numNewlyGenerated = 0;
-    instance().antigenCounts = std::vector<unsigned int> (ParamManager::num_phenotypes , 0);
+    if (n < N_LOG_N_TABLE_SIZE)
+        return nLogNTable[n];
+    return std::llround(n*std::log((double)n) * N_LOG_N_SCALE);
+}
+
+//Thread safe.
+void DiversityMonitor::update_abundance_sums(const unsigned int oldCount, const unsigned int newCount)
+{
+    const int64_t nLogNChange = n_log_n(newCount) - n_log_n(oldCount);
+    #pragma omp atomic
+    sumNLogN += nLogNChange;
+
+    const uint64_t pairChange = (uint64_t)newCount*(newCount-1) - (uint64_t)oldCount*(oldCount-1); //Modular, so fine for losses too.
+    #pragma omp atomic
+    sumPairs += pairChange;
+
+    if (oldCount <= 2 || newCount <= 2) {
+        const int singletonChange = (newCount == 1) - (oldCount == 1);
+        const int doubletonChange = (newCount == 2) - (oldCount == 2);
+        #pragma omp atomic
+        numSingletons += singletonChange;
+        #pragma omp atomic
+        numDoubletons += doubletonChange;
+    }
 }
 
 void DiversityMonitor::register_antigen_gain(Antigen phenotypeID, bool bypassGenerationRegister)
 {
-    if (instance().antigenCounts[phenotypeID] == 0) {
+    unsigned int oldCount;
+    #pragma omp atomic capture
+    oldCount = antigenCounts[phenotypeID]++;
+
+    if (oldCount == 0) {
         #pragma omp atomic
-        instance().uniqueAntigens++;
+        uniqueAntigens++;
         if (bypassGenerationRegister == false) {
             #pragma omp atomic
-            instance().numNewlyGenerated++;
+            numNewlyGenerated++;
         }
     }
     #pragma omp atomic
-    instance().totalAntigens++;
+    totalAntigens++;
 
-    #pragma omp atomic
-    instance().antigenCounts[phenotypeID] += 1;
+    update_abundance_sums(oldCount, oldCount+1);
+
+    if (topAntigens.enabled())
+        topAntigens.touch(phenotypeID);
 }
 
 void DiversityMonitor::register_antigen_loss(Antigen phenotypeID)
 {
     #pragma omp atomic
-    instance().totalAntigens--;
+    totalAntigens--;
 
-    #pragma omp atomic
-    instance().antigenCounts[phenotypeID] -= 1;
+    unsigned int oldCount;
+    #pragma omp atomic capture
+    oldCount = antigenCounts[phenotypeID]--;
+
+    update_abundance_sums(oldCount, oldCount-1);
 
-    if (instance().antigenCounts[phenotypeID] == 0) {
+    if (topAntigens.enabled())
+        topAntigens.touch(phenotypeID);
+
+    if (oldCount == 1) {
         #pragma omp atomic
-        instance().uniqueAntigens--;
+        uniqueAntigens--;
 
         #pragma omp atomic
-        instance().numExtinctions++;
+        numExtinctions++;
     }
 }
 
-void DiversityMonitor::register_new_strain(Strain geneList, bool bypassGenerationRegister)
+void DiversityMonitor::register_new_strain(const Strain& geneList, bool bypassGenerationRegister)
 {
     for (unsigned int a=0; a<geneList.size(); ++a)
-        DiversityMonitor::register_antigen_gain(get_phenotype_id(geneList[a]), bypassGenerationRegister);
+        register_antigen_gain(get_phenotype_id(params, geneList[a]), bypassGenerationRegister);
 }
 
-void DiversityMonitor::register_lost_strain(Strain geneList)
+void DiversityMonitor::register_lost_strain(const Strain& geneList)
 {
     for (unsigned int a=0; a<geneList.size(); ++a)
-        DiversityMonitor::register_antigen_loss(get_phenotype_id(geneList[a]));
+        register_antigen_loss(get_phenotype_id(params, geneList[a]));
 }
 
 void DiversityMonitor::reset_loss_gen_count()
 {
-    instance().numExtinctions = 0;
-    instance().numNewlyGenerated = 0;
+    numExtinctions = 0;
+    numNewlyGenerated = 0;
+}
+
+void DiversityMonitor::rebuild(const std::vector<unsigned int>& counts)
+{
+    totalAntigens = 0;
+    uniqueAntigens = 0;
+    sumNLogN = 0;
+    sumPairs = 0;
+    numSingletons = 0;
+    numDoubletons = 0;
+    for (unsigned int p=0; p<counts.size(); ++p)
+    {
+        if (topAntigens.enabled() && counts[p] != antigenCounts[p])
+            topAntigens.touch(p);
+        antigenCounts[p] = counts[p];
+        totalAntigens += counts[p];
+        uniqueAntigens += counts[p] != 0;
+        update_abundance_sums(0, counts[p]);
+    }
 }
 
-unsigned int DiversityMonitor::get_antigen_count(const unsigned int phenotypeID)
+unsigned int DiversityMonitor::get_antigen_count(const unsigned int phenotypeID) const
 {
-    return instance().antigenCounts[phenotypeID];
+    return antigenCounts[phenotypeID];
 }
 
-const std::vector<unsigned int>& DiversityMonitor::get_antigen_counts()
+const std::vector<unsigned int>& DiversityMonitor::get_antigen_counts() const
 {
-    return instance().antigenCounts;
+    return antigenCounts;
 }
 
-unsigned int DiversityMonitor::get_total_antigens()
+unsigned int DiversityMonitor::get_total_antigens() const
 {
-    return instance().totalAntigens;
+    return totalAntigens;
 }
 
-unsigned int DiversityMonitor::get_num_unique_antigens()
+unsigned int DiversityMonitor::get_num_unique_antigens() const
 {
-    return instance().uniqueAntigens;
+    return uniqueAntigens;
 }
 
 
-unsigned int DiversityMonitor::get_current_generation_count()
+unsigned int DiversityMonitor::get_current_generation_count() const
+{
+    return numNewlyGenerated;
+}
+
+unsigned int DiversityMonitor::get_current_loss_count() const
+{
+    return numExtinctions;
+}
+
+//H = -sum_i p_i ln p_i = ln N - (1/N) sum_i n_i ln n_i
+float DiversityMonitor::get_shannon_entropy() const
+{
+    if (totalAntigens == 0)
+        return 0.0f;
+    return std::log((double)totalAntigens) - (sumNLogN / N_LOG_N_SCALE) / totalAntigens;
+}
+
+float DiversityMonitor::get_simpson_diversity() const
+{
+    if (totalAntigens < 2)
+        return 0.0f;
+    return 1.0 - (double)sumPairs / ((double)totalAntigens*(totalAntigens-1));
+}
+
+//S_obs + F1(F1-1) / (2(F2+1)), Chao (2005). Unlike the classic F1^2 / 2F2 form it is defined when there are no doubletons.
+float DiversityMonitor::get_chao1_richness() const
+{
+    return uniqueAntigens + (double)numSingletons*(numSingletons > 0 ? numSingletons-1 : 0) / (2.0*(numDoubletons+1));
+}
+
+uint64_t DiversityMonitor::memory_bytes() const
+{
+    return memory::vector_bytes(antigenCounts) + memory::vector_bytes(nLogNTable) + topAntigens.memory_bytes();
+}
+
+void DiversityMonitor::save(checkpoint::Writer& out) const
 {
-    return instance().numNewlyGenerated;
+    out.section("DIVM");
+    out.write_vector(antigenCounts);
+    out.write(totalAntigens);
+    out.write(uniqueAntigens);
+    out.write(numNewlyGenerated);
+    out.write(numExtinctions);
+    out.write(sumNLogN);
+    out.write(sumPairs);
+    out.write(numSingletons);
+    out.write(numDoubletons);
+    topAntigens.save(out);
 }
 
-unsigned int DiversityMonitor::get_current_loss_count()
+void DiversityMonitor::load(checkpoint::Reader& in)
 {
-    return instance().numExtinctions;
+    reset(); //Builds the n log n table.
+    in.section("DIVM");
+    in.read_vector(antigenCounts);
+    in.read(totalAntigens);
+    in.read(uniqueAntigens);
+    in.read(numNewlyGenerated);
+    in.read(numExtinctions);
+    in.read(sumNLogN);
+    in.read(sumPairs);
+    in.read(numSingletons);
+    in.read(numDoubletons);
+    topAntigens.load(in);
 }
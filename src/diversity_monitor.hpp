@@ -1,42 +1,75 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include "global_typedefs.hpp"
+#include "top_antigen_tracker.hpp"
 
-//Keeps track of the number of antigens in circulation.
+class ParamManager;
+namespace checkpoint { class Writer; class Reader; }
+
+//Keeps track of the number of antigens in circulation. One per model run (owned by ModelContext).
 class DiversityMonitor
 {
 private:
+    const ParamManager& params;
+
     std::vector<unsigned int> antigenCounts;
 
-    unsigned int totalAntigens;
-    unsigned int uniqueAntigens;
-    unsigned int numNewlyGenerated;
-    unsigned int numExtinctions;
+    unsigned int totalAntigens = 0;
+    unsigned int uniqueAntigens = 0;
+    unsigned int numNewlyGenerated = 0;
+    unsigned int numExtinctions = 0;
+
+    TopAntigenTracker topAntigens; //Only enabled if params.output_top_antigens > 0.
+
+    //Abundance sums over antigens, kept up to date on every gain / loss so diversity indices cost O(1) to output.
+    //sumNLogN is fixed point (see N_LOG_N_SCALE) so that it is exact: each change adds the difference of two rounded table values,
+    //which telescopes, so the result doesn't depend on the order threads make their changes in.
+    static const unsigned int N_LOG_N_TABLE_SIZE = 4096;
+    static const double N_LOG_N_SCALE; //2^20
+    std::vector<int64_t> nLogNTable; //round(n*ln(n) * N_LOG_N_SCALE) for small n
+    int64_t sumNLogN = 0; //sum_i n_i ln n_i, scaled
+    uint64_t sumPairs = 0; //sum_i n_i (n_i-1)
+    unsigned int numSingletons = 0; //Antigens with a count of 1
+    unsigned int numDoubletons = 0; //Antigens with a count of 2
+
+    int64_t n_log_n(const unsigned int n) const;
+    void update_abundance_sums(const unsigned int oldCount, const unsigned int newCount);
 
-    DiversityMonitor(); //Singleton.
 public:
-    static DiversityMonitor& instance() //Singleton instance.
-    {
-        static DiversityMonitor diversityMonitor; //Implicit if flag ensures initialisation occurs only once!
-        return diversityMonitor;
-    }
+    DiversityMonitor(const ParamManager& params) : params(params) {  }
+    DiversityMonitor(const DiversityMonitor&) = delete;
+    void operator=(const DiversityMonitor&) = delete;
+
+    void reset();
+
+    void register_antigen_gain(Antigen phenotypeID, bool bypassGenerationRegister=false);
+
+    void register_antigen_loss(Antigen phenotypeID);
 
-    static void reset();
+    void register_new_strain(const Strain& geneList, bool bypassGenerationRegister=false); //Don't register new generation of strains here (used for reintroducing extinct/initial strains).
 
-    static void register_antigen_gain(Antigen phenotypeID, bool bypassGenerationRegister=false);
+    void register_lost_strain(const Strain& geneList);
 
-    static void register_antigen_loss(Antigen phenotypeID);
+    void reset_loss_gen_count();
 
-    static void register_new_strain(Strain geneList, bool bypassGenerationRegister=false); //Don't register new generation of strains here (used for reintroducing extinct/initial strains).
+    //Replaces the antigen counts (e.g. with a recount, see DiversityAudit) and recalculates everything derived from them. Not thread safe.
+    void rebuild(const std::vector<unsigned int>& counts);
 
-    static void register_lost_strain(Strain geneList);
+    unsigned int get_antigen_count(const unsigned int phenotypeID) const;
+    const std::vector<unsigned int>& get_antigen_counts() const;
+    unsigned int get_total_antigens() const;
+    unsigned int get_num_unique_antigens() const;
+    unsigned int get_current_generation_count() const;
+    unsigned int get_current_loss_count() const;
 
-    static void reset_loss_gen_count();
+    float get_shannon_entropy() const; //Of antigen abundances (natural log).
+    float get_simpson_diversity() const; //Gini-Simpson index: probability two antigens drawn without replacement are different.
+    float get_chao1_richness() const; //Bias corrected Chao1 estimate of the number of antigens, including unobserved ones.
+    uint64_t memory_bytes() const;
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in); //In place of reset().
 
-    static unsigned int get_antigen_count(const unsigned int phenotypeID);
-    static const std::vector<unsigned int>& get_antigen_counts();
-    static unsigned int get_total_antigens();
-    static unsigned int get_num_unique_antigens();
-    static unsigned int get_current_generation_count();
-    static unsigned int get_current_loss_count();
+    //The params.output_top_antigens most abundant antigens, see TopAntigenTracker::update. Must not be called concurrently with gains / losses.
+    uint32_t get_top_antigens(std::vector<TopAntigenTracker::Entry>& top) { return topAntigens.update(antigenCounts, top); }
 };
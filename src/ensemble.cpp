@@ -0,0 +1,159 @@
+#include "ensemble.hpp"
+#include "branching.hpp"
+#include "demographic_tools.hpp"
+#include "memory_report.hpp"
+#include "model_context.hpp"
+#include "model_driver.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <thread>
+
+namespace
+{
+const std::vector<double> QUANTILES = {0.05, 0.25, 0.5, 0.75, 0.95};
+
+//Discards everything written to it. Keeps no state, so any number of threads can write to it at once.
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+}
+
+void EnsembleSummary::add(const unsigned int outputIndex, const std::vector<Output::Series>& series)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (names.empty()) {
+        for (const Output::Series& s : series) {
+            if (s.name != "timesteps")
+                names.push_back(s.name);
+        }
+    }
+    if (cells.size() <= outputIndex) {
+        cells.resize(outputIndex+1, std::vector<Cell>(names.size()));
+        times.resize(outputIndex+1, 0);
+    }
+
+    unsigned int i = 0;
+    for (const Output::Series& s : series)
+    {
+        if (s.name == "timesteps") {
+            times[outputIndex] = s.uints->back();
+            continue;
+        }
+        const double value = s.floats != nullptr ? s.floats->back() : s.uints->back();
+        Cell& cell = cells[outputIndex][i++];
+        ++cell.count;
+        cell.sum += value;
+        cell.sumSquares += value*value;
+        cell.values.update(value);
+    }
+}
+
+void EnsembleSummary::write(const std::string& prefix) const
+{
+    for (unsigned int i=0; i<names.size(); ++i)
+    {
+        std::ofstream file(prefix+"_ensemble_"+names[i]+".csv", std::ofstream::out | std::ofstream::trunc);
+        file << "time, replicates, mean, sd, p5, p25, p50, p75, p95\n";
+        for (unsigned int o=0; o<cells.size(); ++o)
+        {
+            const Cell& cell = cells[o][i];
+            if (cell.count == 0)
+                continue;
+            const double mean = cell.sum / cell.count;
+            const double variance = cell.count > 1 ? std::max(0.0, (cell.sumSquares - cell.sum*mean) / (cell.count-1)) : 0.0;
+            file << times[o] << ", " << cell.count << ", " << mean << ", " << std::sqrt(variance);
+            for (const float q : cell.values.quantiles(QUANTILES))
+                file << ", " << q;
+            file << "\n";
+        }
+    }
+}
+
+void ensemble::run(const ParamManager& params, const std::vector<std::pair<std::string, std::string>>& settings)
+{
+    const unsigned int numReplicates = params.ensemble_size;
+    const unsigned int numConcurrent = std::min(numReplicates, utilities::max_threads());
+    const MemoryUsage projected = memory::project(params);
+    memory::print(std::cout, "Projected memory use per replicate (worst case)", projected);
+    std::cout << "Projected memory use of " << numConcurrent << " replicates at once: " << memory::format_bytes(numConcurrent*projected.total()) << std::endl;
+    if (params.dry_run)
+        return;
+
+    const std::string prefix = params.file_path()+params.run_name();
+    const uint64_t baseSeed = params.random_seed != 0 ? params.random_seed : time(NULL);
+    {
+        std::ofstream file(prefix+"_seed.txt", std::ofstream::out | std::ofstream::trunc);
+        file << baseSeed;
+    }
+    std::shared_ptr<const DemographicTables> tables = generate_demographic_tables(params);
+
+    //The replicates' own progress output would be interleaved, so it is discarded while they run.
+    NullBuffer nullBuffer;
+    std::ostream console(std::cout.rdbuf());
+    std::cout.rdbuf(&nullBuffer);
+    console << "Running " << numReplicates << " replicates, " << numConcurrent << " at a time." << std::endl;
+
+    EnsembleSummary summary;
+    std::vector<std::string> errors(numReplicates);
+    std::atomic<unsigned int> nextReplicate(0);
+    std::mutex consoleMutex;
+    unsigned int numFinished = 0;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    //std::threads rather than an OpenMP team: each is then an initial thread of its own, so the model's parallel regions (and
+    //utilities::thread_num()) behave just as in a single threaded run.
+    std::vector<std::thread> workers;
+    for (unsigned int w=0; w<numConcurrent; ++w)
+    {
+        workers.push_back(std::thread([&]() {
+            utilities::set_num_threads(1);
+            for (unsigned int r=nextReplicate++; r<numReplicates; r=nextReplicate++)
+            {
+                try {
+                    ModelContext ctx;
+                    ModelDriver model(ctx);
+                    for (const std::pair<std::string, std::string>& setting : settings)
+                        branching::apply_setting(setting.first, setting.second, ctx, model);
+                    ctx.params.runName = params.run_name() + "_r" + std::to_string(r);
+                    ctx.params.random_seed = baseSeed + r;
+                    ctx.params.recalculate_derived_parameters();
+                    ctx.tables = tables;
+                    model.set_ensemble(&summary);
+                    if (std::ifstream(prefix+"_calling_arguments.txt").is_open()) //Written by main, and stored in binary output.
+                        branching::copy_file(prefix+"_calling_arguments.txt", ctx.params.file_path()+ctx.params.run_name()+"_calling_arguments.txt");
+
+                    model.run_model();
+
+                    std::lock_guard<std::mutex> lock(consoleMutex);
+                    console << "replicate " << r << " finished (" << ++numFinished << "/" << numReplicates << ") in " << model.get_simulation_seconds() << "s." << std::endl;
+                }
+                catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(consoleMutex);
+                    errors[r] = e.what();
+                    std::cerr << "replicate " << r << ": " << e.what() << std::endl;
+                }
+            }
+        }));
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    std::cout.rdbuf(console.rdbuf());
+
+    std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - wallStart;
+    std::cout << "Ran " << numReplicates << " replicates in " << wallTime.count() << "s." << std::endl;
+    summary.write(prefix);
+
+    unsigned int numFailed = 0;
+    for (const std::string& error : errors)
+        numFailed += !error.empty();
+    if (numFailed != 0)
+        throw std::runtime_error("ensemble::run: " + std::to_string(numFailed) + " of " + std::to_string(numReplicates) + " replicates failed (see the errors above).");
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "output.hpp"
+#include "quantile_sketch.hpp"
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ParamManager;
+
+//Across replicate summary of every output series, built as the replicates run: each replicate hands over its latest values at every
+//output (Output::append_output), so nothing but the summary is kept once a replicate has finished. Per series and output time it keeps
+//a running sum and sum of squares (mean, sd) and a QuantileSketch, which holds every value exactly for ensembles of up to 200.
+//Thread safe: replicates running side by side share one summary.
+class EnsembleSummary
+{
+private:
+    struct Cell
+    {
+        unsigned int count = 0;
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        QuantileSketch values;
+    };
+
+    std::vector<std::string> names; //Every series but the timesteps, in output order. Taken from the first replicate to output.
+    std::vector<unsigned int> times; //Per output.
+    std::vector<std::vector<Cell>> cells; //Per output, per series.
+    std::mutex mutex;
+
+public:
+    void add(const unsigned int outputIndex, const std::vector<Output::Series>& series); //The latest value of each series.
+
+    //One file per series, prefix_ensemble_<series>.csv: "time, replicates, mean, sd, p5, p25, p50, p75, p95", one row per output time.
+    void write(const std::string& prefix) const;
+};
+
+//Ensemble mode (ensemble_size): replicates of one parameter set run side by side in one process, each on a single thread of its own,
+//which uses small populations far better than giving every thread to one run. Replicate r is exactly the single threaded run with
+//random_seed+r (the seed is taken from the clock once, if random_seed is 0) and writes the usual output as runName_r<r>. The demographic
+//PTABLEs are generated (and written) once and shared. Replicates' progress output is discarded; each replicate is reported as it finishes.
+namespace ensemble
+{
+    //'settings' are the command line's token value pairs, applied to each replicate as to a single run. 'params' are those settings applied
+    //once already. Throws std::runtime_error, once every replicate has finished, if any failed.
+    void run(const ParamManager& params, const std::vector<std::pair<std::string, std::string>>& settings);
+}
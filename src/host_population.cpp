@@ -0,0 +1,166 @@
+#include "host_population.hpp"
+#include "checkpoint.hpp"
+#include "memory_report.hpp"
+#include "model_context.hpp"
+#include <cstring>
+#include <mutex>
+
+void HostPopulation::resize(const unsigned int n)
+{
+    numHosts = n;
+    numPhenotypes = ctx.params.num_phenotypes;
+    today = 0;
+    clearances.clear();
+
+    age.assign(n, 0);
+    for (unsigned int s=0; s<NUM_INFECTION_SLOTS; ++s)
+    {
+        infected[s].assign(n, 0);
+        clearDay[s].assign(n, 0);
+        infectivity[s].assign(n, 0.0f);
+        strains[s].clear();
+        strains[s].resize(n);
+    }
+    immuneStates.reset(new float[(size_t)n*numPhenotypes]); //Not value initialised, see kill().
+}
+
+uint64_t HostPopulation::memory_bytes() const
+{
+    uint64_t bytes = memory::vector_bytes(age) + clearances.memory_bytes() + (uint64_t)numHosts*numPhenotypes*sizeof(float);
+    for (unsigned int s=0; s<NUM_INFECTION_SLOTS; ++s)
+    {
+        bytes += memory::vector_bytes(infected[s]) + memory::vector_bytes(clearDay[s]) + memory::vector_bytes(infectivity[s]) + memory::vector_bytes(strains[s]);
+        for (const Strain& strain : strains[s])
+            bytes += memory::vector_bytes(strain);
+    }
+    return bytes;
+}
+
+void HostPopulation::save(checkpoint::Writer& out) const
+{
+    out.section("HOST");
+    out.write(numHosts);
+    out.write(numPhenotypes);
+    out.write(today);
+    out.write_vector(age);
+    for (unsigned int s=0; s<NUM_INFECTION_SLOTS; ++s)
+    {
+        out.write_vector(infected[s]);
+        out.write_vector(clearDay[s]);
+        out.write_vector(infectivity[s]);
+        out.write_vectors(strains[s]);
+    }
+    clearances.save(out);
+    out.write_array(immuneStates.get(), (uint64_t)numHosts*numPhenotypes);
+}
+
+void HostPopulation::load(checkpoint::Reader& in)
+{
+    in.section("HOST");
+    in.expect(ctx.params.num_hosts, "num_hosts");
+    in.expect(ctx.params.num_phenotypes, "num_phenotypes");
+    resize(ctx.params.num_hosts);
+    in.read(today);
+    in.read_vector(age);
+    for (unsigned int s=0; s<NUM_INFECTION_SLOTS; ++s)
+    {
+        in.read_vector(infected[s]);
+        in.read_vector(clearDay[s]);
+        in.read_vector(infectivity[s]);
+        in.read_vectors(strains[s]);
+    }
+    clearances.load(in);
+
+    //Copied with the same static schedule as the agent loops, so each row is first touched by the thread that will own it (see ModelDriver::initialise_model).
+    const size_t rowBytes = (size_t)numPhenotypes*sizeof(float);
+    const char* rows = in.take(rowBytes*numHosts);
+    #pragma omp parallel for schedule(static)
+    for (unsigned int b=0; b<num_blocks(); ++b)
+        std::memcpy(&immuneStates[(size_t)block_begin(b)*numPhenotypes], rows + block_begin(b)*rowBytes, (block_end(b)-block_begin(b))*rowBytes);
+}
+
+//Attempt to infect a host. Uses the first free infection slot, if any.
+void HostPopulation::infect(const unsigned int h, const Strain& strain)
+{
+    //Per model lock rather than a named critical section, so concurrently running models don't serialise each other.
+    std::lock_guard<std::mutex> lock(ctx.hostInfectionMutex);
+
+    for (unsigned int s=0; s<NUM_INFECTION_SLOTS; ++s)
+    {
+        if (infected[s][h])
+            continue;
+
+        float* immuneState = &immuneStates[(size_t)h*numPhenotypes];
+        unsigned int projectedDuration = duration_kernal(ctx.params, strain, immuneState);
+        if (projectedDuration > 0) {
+            infected[s][h] = 1;
+            strains[s][h] = strain;
+            infectivity[s][h] = infectivity_kernal(ctx.params, strain, immuneState);
+            clearDay[s][h] = today + projectedDuration + 1; //Cleared on the (projectedDuration+1)th day from now, as the old daily countdown did.
+            clearances.schedule(ClearanceEvent{clearDay[s][h], h, s});
+            exposure_kernal(ctx.params, strain, immuneState);
+            ctx.diversity.register_new_strain(strain);
+            if (ctx.distributions.enabled())
+                ctx.distributions.record_infection(projectedDuration, age[h]);
+        }
+        return; //Only the first free slot is tried.
+    }
+}
+
+void HostPopulation::kill(const unsigned int h)
+{
+    age[h] = 0;
+    for (unsigned int s=0; s<NUM_INFECTION_SLOTS; ++s)
+        clear_infection(h, s);
+    std::fill_n(&immuneStates[(size_t)h*numPhenotypes], numPhenotypes, 0.0f);
+}
+
+void HostPopulation::clear_infection(const unsigned int h, const unsigned int slot)
+{
+    if (infected[slot][h]) //register loss of antigen abundance
+        ctx.diversity.register_lost_strain(strains[slot][h]);
+
+    infected[slot][h] = 0;
+    infectivity[slot][h] = 0.0f;
+}
+
+//Age hosts and kill / replace them with newborns if necessary.
+void HostPopulation::age_block(const unsigned int block, const PTABLE& pDeath)
+{
+    utilities::RandomStream& rng = ctx.rng();
+    const unsigned int begin = block_begin(block);
+    const unsigned int n = block_end(block) - begin;
+
+    //Random numbers are drawn first so the update loop below has no loop carried dependency and can be vectorised.
+    float draws[BLOCK_SIZE];
+    for (unsigned int j=0; j<n; ++j)
+        draws[j] = rng.random_float01();
+
+    uint32_t* blockAge = &age[begin];
+    uint8_t dies[BLOCK_SIZE];
+    for (unsigned int j=0; j<n; ++j)
+    {
+        const unsigned int years = std::min<unsigned int>(blockAge[j] / 365, pDeath.size()-1);
+        dies[j] = draws[j] < pDeath[years];
+        blockAge[j] = dies[j] ? 0 : blockAge[j]+1;
+    }
+
+    for (unsigned int j=0; j<n; ++j)
+    {
+        if (dies[j])
+            kill(begin+j);
+    }
+}
+
+unsigned int HostPopulation::expire_infections(const unsigned int day)
+{
+    today = day;
+    unsigned int numCleared = 0;
+    clearances.expire(day, [this, &numCleared](const ClearanceEvent& event) {
+        if (infected[event.slot][event.host] && clearDay[event.slot][event.host] == event.day) {
+            clear_infection(event.host, event.slot);
+            ++numCleared;
+        }
+    });
+    return numCleared;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "infection.hpp"
+#include "param_manager.hpp"
+#include "timing_wheel.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ModelContext;
+
+//Structure of arrays store for the host population. Each host has NUM_INFECTION_SLOTS infection slots. The daily loop only touches the
+//hot arrays (age and infection flags). Strains and immune states are cold data, only used when a host is bitten or when output is
+//calculated. Hosts are processed in blocks, and each block is handled by one thread.
+//Infections are cleared by a timing wheel of clearance events, so only the infections that end on a given day are visited.
+class HostPopulation
+{
+public:
+    static const unsigned int NUM_INFECTION_SLOTS = 2;
+    static const unsigned int BLOCK_SIZE = 64;
+
+private:
+    ModelContext& ctx;
+    unsigned int numHosts = 0;
+    unsigned int numPhenotypes = 0;
+    unsigned int today = 0;
+
+    //Hot
+    std::vector<uint32_t> age; //In days
+    std::array<std::vector<uint8_t>, NUM_INFECTION_SLOTS> infected;
+    std::array<std::vector<uint32_t>, NUM_INFECTION_SLOTS> clearDay; //Day on which the infection is cleared.
+    std::array<std::vector<float>, NUM_INFECTION_SLOTS> infectivity;
+
+    //Cold
+    std::array<std::vector<Strain>, NUM_INFECTION_SLOTS> strains;
+    struct ClearanceEvent { unsigned int day; unsigned int host; unsigned int slot; };
+    TimingWheel<ClearanceEvent> clearances; //Stale events (host died / was reinfected since) are skipped when they expire.
+    std::unique_ptr<float[]> immuneStates; //numHosts x numPhenotypes, one row per host. Left uninitialised until kill() so each row is first touched by the thread that owns the host.
+
+public:
+    HostPopulation(ModelContext& _ctx) : ctx(_ctx) {  }
+
+    void resize(const unsigned int n); //Every host must be kill()ed before use.
+
+    unsigned int size() const { return numHosts; }
+    unsigned int num_blocks() const { return (numHosts+BLOCK_SIZE-1) / BLOCK_SIZE; }
+    unsigned int block_begin(const unsigned int block) const { return block*BLOCK_SIZE; }
+    unsigned int block_end(const unsigned int block) const { return std::min((block+1)*BLOCK_SIZE, numHosts); }
+    unsigned int get_num_phenotypes() const { return numPhenotypes; }
+    uint64_t memory_bytes() const; //Visits every strain, so O(hosts).
+
+    bool is_infected(const unsigned int h) const { return infected[0][h] | infected[1][h]; }
+    bool is_infected(const unsigned int h, const unsigned int slot) const { return infected[slot][h]; }
+    unsigned int get_age(const unsigned int h) const { return age[h]; }
+    unsigned int get_duration_remaining(const unsigned int h, const unsigned int slot) const { return infected[slot][h] ? clearDay[slot][h] - today - 1 : 0; } //Days left after today.
+    float get_infectivity(const unsigned int h, const unsigned int slot) const { return infectivity[slot][h]; }
+    const Strain& get_strain(const unsigned int h, const unsigned int slot) const { return strains[slot][h]; }
+    const float* get_immune_state(const unsigned int h) const { return &immuneStates[(size_t)h*numPhenotypes]; }
+
+    void set_age(const unsigned int h, const unsigned int newAge) { age[h] = newAge; }
+
+    void infect(const unsigned int h, const Strain& strain);
+    void kill(const unsigned int h);
+    void clear_infection(const unsigned int h, const unsigned int slot);
+
+    //Advances to 'day' and clears the infections which end on it, returning how many. Not thread safe.
+    unsigned int expire_infections(const unsigned int day);
+
+    //Daily update over one block. Only one thread may work on a block at a time.
+    void age_block(const unsigned int block, const PTABLE& pDeath);
+
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in); //In place of resize() and kill()ing every host.
+};
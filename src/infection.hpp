@@ -1,19 +1,10 @@
 #pragma once
 #include "strain.hpp"
 
-class Infection
-{
-public:
-    bool infected = false;
-    unsigned int durationRemaining = 0; //Either latent period (in mosquitoes) or infection duration (in hosts)
-    Strain strain;
-    float infectivity = 0.0f;
-
-    void reset();
-    std::string to_string() const;
-};
+class ParamManager;
 
 //Temporary - need to be replaced with function pointers and modularised.
-float infectivity_kernal(const Strain& strain, const ImmuneState& immuneState);
-unsigned short duration_kernal(const Strain& strain, const ImmuneState& immuneState);
-void exposure_kernal(const Strain& strain, ImmuneState& immuneState);
+//immuneState points to a host's row of HostPopulation's immune state matrix (num_phenotypes long).
+float infectivity_kernal(const ParamManager& params, const Strain& strain, const float* immuneState);
+unsigned short duration_kernal(const ParamManager& params, const Strain& strain, const float* immuneState);
+void exposure_kernal(const ParamManager& params, const Strain& strain, float* immuneState);
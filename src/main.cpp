@@ -1,44 +1,47 @@
 #include <iostream>
-#include "param_manager.hpp"
+#include "branching.hpp"
+#include "ensemble.hpp"
+#include "model_context.hpp"
 #include "model_driver.hpp"
 #include "testing.hpp"
 #include "utilities.hpp"
 #include <fstream>
 #include <sstream>
 #include <limits>
-#include "adaptors/mosquito_population_adaptor.hpp"
-#include "adaptors/bite_rate_adaptor.hpp"
-#include "adaptors/output_interval_adaptor.hpp"
-#include "adaptors/intragenic_recombination_p_adaptor.hpp"
-
-#include "diversity_monitor.hpp"
-
-#include "host.hpp"
+#include "host_population.hpp"
 #include "output.hpp"
 
-void parse_parameters_from_cmd(int argc, char* argv[], ModelDriver& model);
-void parse_adaptor_from_cmd(const std::string& adaptorType, const std::string& argList, ModelDriver& model);
+void parse_parameters_from_cmd(int argc, char* argv[], ModelContext& ctx, ModelDriver& model);
 void test();
 
 int main(int argc, char* argv[])
 {
     //testing::test_diversity_counting();
+    //testing::test_checkpoint_resume();
     //test();
     //return 0;
 
 
-    ModelDriver model; //Empty project so we can setup references / pointers.
-    parse_parameters_from_cmd(argc, argv, model); //Throws exception if fails.
-    //ParamManager::output_host_susceptibility = true;
-    ParamManager::recalculate_derived_parameters();
+    ModelContext ctx;
+    ModelDriver model(ctx); //Empty project so we can setup references / pointers.
+    parse_parameters_from_cmd(argc, argv, ctx, model); //Throws exception if fails.
+    //ctx.params.output_host_susceptibility = true;
+    ctx.params.recalculate_derived_parameters();
 
-    model.run_model();
+    if (ctx.params.ensemble_size > 1) {
+        std::vector<std::pair<std::string, std::string>> settings;
+        for (int i=1; i+1<argc; i+=2)
+            settings.push_back(std::make_pair(std::string(argv[i]), std::string(argv[i+1])));
+        ensemble::run(ctx.params, settings); //Every replicate is set up from the same arguments.
+    }
+    else
+        model.run_model();
 
 
     return 0;
 }
 
-void parse_parameters_from_cmd(int argc, char* argv[], ModelDriver& model)
+void parse_parameters_from_cmd(int argc, char* argv[], ModelContext& ctx, ModelDriver& model)
 {
     //Check number of cmdline arguments
     if ((argc-1) % 2 != 0) //Must be an odd number of arguments, as it is the first argument plus a number of parameter:value pairs.
@@ -50,18 +53,15 @@ void parse_parameters_from_cmd(int argc, char* argv[], ModelDriver& model)
         std::string token(argv[i]);
         std::string value(argv[i+1]);
 
-        if (token.find("adaptor") != std::string::npos) //If it's an adaptor definition parse it as an adaptor
-            parse_adaptor_from_cmd(token, value, model);
-        else //...otherwise assume it is setting a parameter
-            ParamManager::set_param(token, value); //Throwes exception if token doesn't name an existing parameter.
+        branching::apply_setting(token, value, ctx, model); //An adaptor if the token names one, otherwise a parameter. Throws exception if token doesn't name an existing parameter.
     }
 
-    if (ParamManager::recalculate_derived_parameters() == false) //Some parameters are derived from others, now user parameters have changed these need calculating.
+    if (ctx.params.recalculate_derived_parameters() == false) //Some parameters are derived from others, now user parameters have changed these need calculating.
         std::runtime_error("ERROR: Cannot set derived parameters - this indicates inconsistent parameter states e.g. stop time before start time in dynamic parameters.");
 
     //Write called arguments to file
     std::ofstream file;
-    file.open(ParamManager::file_path()+ParamManager::run_name()+"_calling_arguments.txt", std::ofstream::out | std::ofstream::trunc);
+    file.open(ctx.params.file_path()+ctx.params.run_name()+"_calling_arguments.txt", std::ofstream::out | std::ofstream::trunc);
     file << argv[0] << "\n\n";
     for (int i=1; i<argc; i+=2)
         file << argv[i] << " " << argv[i+1] << "\n";
@@ -69,83 +69,39 @@ void parse_parameters_from_cmd(int argc, char* argv[], ModelDriver& model)
     file.close();
 }
 
-void parse_adaptor_from_cmd(const std::string &adaptorType, const std::string &argList, ModelDriver& model)
-{
-    const char delim = '+';
-
-    std::stringstream ss;
-    ss.str(argList);
-    std::string curItem;
-
-    //Parse start time.
-    std::getline(ss, curItem, delim);
-    //std::cout << "tStart:" << curItem << std::endl;
-    unsigned int tStart = std::stoi(curItem);
-
-    //Parse stop time.
-    std::getline(ss, curItem, delim);
-    //std::cout << "tStop:" << curItem << std::endl;
-    unsigned int tStop = std::stoi(curItem);
-
-    //Load target value into curItem but don't make any assumptions about the type until we know the adaptor type.
-    std::getline(ss, curItem, delim);
-    //std::cout << "target:" << curItem << std::endl;
-
-    //Create the adaptor based on adaptorType string.
-    if (adaptorType.find("mosquito_population_adaptor") != std::string::npos) {
-        unsigned int targetPopulation = std::stoi(curItem);
-        ParamManager::add_adaptor(new MosquitoPopulationAdaptor(tStart, tStop, targetPopulation, model.get_mos_manager()));
-        std::cout << "Added mosquito_population_adaptor.\n";
-    }
-    else if (adaptorType.find("bite_rate_adaptor") != std::string::npos) {
-        float targetBiteRate = std::stof(curItem);
-        ParamManager::add_adaptor(new BiteRateAdaptor(tStart, tStop, targetBiteRate));
-        std::cout << "Added bite_rate_adaptor.\n";
-    }
-    else if (adaptorType.find("intragenic_recombination_p_adaptor") != std::string::npos) {
-        float targetIntragenicRecombinationP = std::stof(curItem);
-        ParamManager::add_adaptor(new IntragenicRecombinationPAdaptor(tStart, tStop, targetIntragenicRecombinationP));
-        std::cout << "Added intragenic_recombination_p_adaptor.\n";
-    }
-    else if (adaptorType.find("output_interval_adaptor") != std::string::npos) {
-        unsigned int targetOutputInterval = std::stoi(curItem);
-        ParamManager::add_adaptor(new OutputIntervalAdaptor(tStart, tStop, targetOutputInterval));
-        std::cout << "Added output_interval_adaptor.\n";
-    }
-}
-
 void test()
 {
-    ModelDriver model;
-
-    ParamManager::bite_rate = 4.0;
-    ParamManager::run_time = 1000;
-
-    ParamManager::output_interval = 1;//250;
-    ParamManager::burn_in_period = 0;//3000;
-    ParamManager::num_hosts = 1;
-    ParamManager::initial_num_mosquitoes = 1000;
-    ParamManager::initial_antigen_diversity = 60;
-    ParamManager::initial_num_strains = 1;
-    ParamManager::initial_num_mosquito_infections = 500;
-    ParamManager::num_phenotypes = 60;
-    ParamManager::num_genotype_only_bits = 7;
-    ParamManager::genotypic_space_size = std::numeric_limits<unsigned int>::max();
-    ParamManager::repertoire_size = 60;
-    ParamManager::mean_mosquito_life_expectancy = 32; //In days, Bellan2010.
-    ParamManager::mosquito_eip = 10; //Extrinsic inoculation period in days, Deitz1974.
-    ParamManager::reintroduction_interval = 0;
-
-    ParamManager::intergenic_recombination_p = 0.0f;
-    ParamManager::intragenic_recombination_p = 0.0f;
-    ParamManager::recombination_scale = 1.0f;
-    ParamManager::infection_duration_scale = 3.0f;
-    ParamManager::infectivity_scale = 0.5f;
-    ParamManager::cross_immunity = 0.0f;
-    ParamManager::immunityScale = 1.0f;
-    ParamManager::unique_initial_strains = true;
-
-    ParamManager::recalculate_derived_parameters();
+    ModelContext ctx;
+    ModelDriver model(ctx);
+
+    ctx.params.bite_rate = 4.0;
+    ctx.params.run_time = 1000;
+
+    ctx.params.output_interval = 1;//250;
+    ctx.params.burn_in_period = 0;//3000;
+    ctx.params.num_hosts = 1;
+    ctx.params.initial_num_mosquitoes = 1000;
+    ctx.params.initial_antigen_diversity = 60;
+    ctx.params.initial_num_strains = 1;
+    ctx.params.initial_num_mosquito_infections = 500;
+    ctx.params.num_phenotypes = 60;
+    ctx.params.num_genotype_only_bits = 7;
+    ctx.params.genotypic_space_size = std::numeric_limits<unsigned int>::max();
+    ctx.params.repertoire_size = 60;
+    ctx.params.mean_mosquito_life_expectancy = 32; //In days, Bellan2010.
+    ctx.params.mosquito_eip = 10; //Extrinsic inoculation period in days, Deitz1974.
+    ctx.params.reintroduction_interval = 0;
+
+    ctx.params.intergenic_recombination_p = 0.0f;
+    ctx.params.intragenic_recombination_p = 0.0f;
+    ctx.params.recombination_scale = 1.0f;
+    ctx.params.infection_duration_scale = 3.0f;
+    ctx.params.infectivity_scale = 0.5f;
+    ctx.params.cross_immunity = 0.0f;
+    ctx.params.immunityScale = 1.0f;
+    ctx.params.unique_initial_strains = true;
+
+    ctx.params.recalculate_derived_parameters();
 
     model.run_model();
 }
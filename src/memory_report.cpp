@@ -0,0 +1,112 @@
+#include "memory_report.hpp"
+#include "host_population.hpp"
+#include "param_manager.hpp"
+#include "strain_census.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+MemoryUsage memory::project(const ParamManager& params)
+{
+    const uint64_t numHosts = params.num_hosts;
+    const uint64_t numPhenotypes = params.num_phenotypes;
+    const uint64_t numMosquitoes = std::max(params.max_num_mosquitoes, params.initial_num_mosquitoes);
+    const uint64_t numSlots = HostPopulation::NUM_INFECTION_SLOTS;
+    const uint64_t strainBytes = sizeof(Strain) + (uint64_t)params.repertoire_size*sizeof(Antigen);
+    const unsigned int numThreads = utilities::max_threads();
+    MemoryUsage usage;
+
+    //Per host: immune state row and age, then per slot the infected flag, clearance day, infectivity, strain and a clearance event.
+    usage.hosts = numHosts * (numPhenotypes*sizeof(float) + sizeof(uint32_t) + numSlots*(sizeof(uint8_t) + sizeof(uint32_t) + sizeof(float) + strainBytes + 3*sizeof(unsigned int)));
+
+    //Age, infectious day and strain per slot, plus the infected bitset.
+    usage.mosquitoes = numMosquitoes*(sizeof(uint16_t) + sizeof(uint32_t) + strainBytes) + (numMosquitoes+63)/64*sizeof(uint64_t);
+
+    usage.diversity = numPhenotypes*sizeof(unsigned int) + 4096*sizeof(int64_t); //Antigen counts and the n log n table.
+    if (params.output_top_antigens > 0) //Touched bits, plus every antigen touched since the last output.
+        usage.diversity += (numPhenotypes+63)/64*sizeof(uint64_t) + numPhenotypes*sizeof(uint32_t);
+    if (params.audit_interval > 0) //Per thread recounts and the merged one.
+        usage.diversity += (numThreads+1)*numPhenotypes*sizeof(unsigned int);
+
+    //12 series are always output, each one value per output.
+    const uint64_t numOutputs = params.stream_output ? 1 : params.output_size_needed;
+    uint64_t numSeries = 12;
+    numSeries += params.output_host_susceptibility + (params.output_top_antigens > 0) + 15*params.output_distributions;
+    numSeries += params.dyn_num_mosquitoes + params.dyn_bite_rate + params.dyn_intragenic_recombination_p;
+    usage.output = numOutputs*numSeries*sizeof(float) + (uint64_t)params.output_top_antigens*2*sizeof(uint32_t);
+    if (params.output_antigen_frequency) {
+        //Latest row plus an (index, value) pair for every antigen at every output held (just the latest, if written as it goes).
+        const uint64_t numRowsHeld = params.sparse_antigen_frequency ? 1 : numOutputs;
+        usage.output += numPhenotypes*sizeof(uint32_t) + numRowsHeld*(numPhenotypes*2*sizeof(uint32_t) + sizeof(uint64_t));
+    }
+
+    if (params.output_strain_structure)
+        usage.strainStructure = StrainCensus::projected_bytes(numSlots*numHosts + numMosquitoes, numThreads);
+
+    return usage;
+}
+
+std::string memory::format_bytes(const uint64_t bytes)
+{
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = bytes;
+    unsigned int u = 0;
+    while (value >= 1024.0 && u < 4)
+    {
+        value /= 1024.0;
+        ++u;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(u == 0 ? 0 : 2) << value << " " << units[u];
+    return ss.str();
+}
+
+void memory::print(std::ostream& out, const std::string& title, const MemoryUsage& usage)
+{
+    out << title << ": " << format_bytes(usage.total()) << "\n"
+        << "  hosts:            " << format_bytes(usage.hosts) << "\n"
+        << "  mosquitoes:       " << format_bytes(usage.mosquitoes) << "\n"
+        << "  diversity:        " << format_bytes(usage.diversity) << "\n"
+        << "  output:           " << format_bytes(usage.output) << "\n"
+        << "  strain structure: " << format_bytes(usage.strainStructure) << std::endl;
+}
+
+#ifdef __linux__
+namespace
+{
+//Reads a "Name:   1234 kB" line of /proc/self/status.
+uint64_t read_status_kb(const std::string& name)
+{
+    std::ifstream file("/proc/self/status");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.compare(0, name.size(), name) == 0 && line.size() > name.size() && line[name.size()] == ':')
+            return std::stoull(line.substr(name.size()+1)) * 1024;
+    }
+    return 0;
+}
+}
+
+uint64_t memory::current_rss()
+{
+    return read_status_kb("VmRSS");
+}
+
+uint64_t memory::peak_rss()
+{
+    return read_status_kb("VmHWM");
+}
+#else
+uint64_t memory::current_rss()
+{
+    return 0;
+}
+
+uint64_t memory::peak_rss()
+{
+    return 0;
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ParamManager;
+
+//Bytes held by each part of a model, as container capacities (allocator overheads aren't counted, so RSS will be a little higher).
+struct MemoryUsage
+{
+    uint64_t hosts = 0; //Immune states, infection slots, strains and the clearance timing wheel.
+    uint64_t mosquitoes = 0;
+    uint64_t diversity = 0; //DiversityMonitor (and DiversityAudit's recount).
+    uint64_t output = 0; //Output history series and antigen frequencies.
+    uint64_t strainStructure = 0; //StrainCensus hash maps (output_strain_structure).
+
+    uint64_t total() const { return hosts + mosquitoes + diversity + output + strainStructure; }
+};
+
+namespace memory
+{
+    template <typename T>
+    uint64_t vector_bytes(const std::vector<T>& v) { return (uint64_t)v.capacity() * sizeof(T); }
+
+    //Bucket array plus one node (next pointer, cached hash and value) per element, as libstdc++ lays them out.
+    template <typename Map>
+    constexpr uint64_t node_bytes() { return sizeof(void*) + sizeof(size_t) + sizeof(typename Map::value_type); }
+    template <typename Map>
+    uint64_t unordered_map_bytes(const Map& map) { return (uint64_t)map.bucket_count()*sizeof(void*) + (uint64_t)map.size()*node_bytes<Map>(); }
+
+    //Worst case for the parameters: every infection slot and mosquito infected, every output stored, every antigen changing frequency
+    //between outputs and every infection a distinct strain. Uses nothing but the parameters, so it can be called before allocating.
+    MemoryUsage project(const ParamManager& params);
+
+    void print(std::ostream& out, const std::string& title, const MemoryUsage& usage);
+    std::string format_bytes(const uint64_t bytes); //e.g. "1.50 GiB"
+
+    //Resident set size of the process now, and its peak (VmRSS / VmHWM). 0 where unavailable (not Linux).
+    uint64_t current_rss();
+    uint64_t peak_rss();
+}
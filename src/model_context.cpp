@@ -0,0 +1,56 @@
+#include "model_context.hpp"
+#include "checkpoint.hpp"
+#include <ctime>
+
+void ModelContext::initialise_random()
+{
+    seed = params.random_seed != 0 ? params.random_seed : time(NULL);
+
+    //One stream per thread, each seeded from a different point of the splitmix64 sequence.
+    rngs.clear();
+    for (unsigned int t=0; t<utilities::max_threads(); ++t)
+        rngs.push_back(utilities::RandomStream(seed + t*0x9E3779B97F4A7C15ULL));
+    write_seed();
+}
+
+void ModelContext::write_seed() const
+{
+    std::ofstream file;
+    file.open(params.file_path()+params.run_name()+"_seed.txt", std::ofstream::out | std::ofstream::trunc);
+    file << seed;
+
+    file.flush();
+    file.close();
+}
+
+void ModelContext::initialise_tables()
+{
+    if (!tables)
+        tables = generate_demographic_tables(params);
+}
+
+void ModelContext::save(checkpoint::Writer& out) const
+{
+    out.section("CTXT");
+    out.write(seed);
+    out.write<uint64_t>(rngs.size());
+    for (const utilities::RandomStream& stream : rngs)
+        out.write(stream.get_state());
+    params.save(out);
+    diversity.save(out);
+    distributions.save(out);
+}
+
+void ModelContext::load(checkpoint::Reader& in)
+{
+    in.section("CTXT");
+    in.read(seed);
+    rngs.assign(utilities::max_threads(), utilities::RandomStream());
+    in.expect<uint64_t>(rngs.size(), "number of threads");
+    for (utilities::RandomStream& stream : rngs)
+        stream.set_state(in.read<uint64_t>());
+    write_seed();
+    params.load(in);
+    diversity.load(in);
+    distributions.load(in);
+}
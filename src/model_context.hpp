@@ -0,0 +1,47 @@
+#pragma once
+#include "param_manager.hpp"
+#include "diversity_monitor.hpp"
+#include "distribution_monitor.hpp"
+#include "demographic_tools.hpp"
+#include "utilities.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//Everything a single model run needs that isn't agent state: parameters (and the adaptors which change them), the diversity
+//and distribution monitors, one random number stream per thread and the demographic PTABLEs. Passed explicitly to everything that needs it, so
+//several independent models can run concurrently in one process. The PTABLEs are immutable and may be shared between contexts.
+class ModelContext
+{
+private:
+    std::vector<utilities::RandomStream> rngs;
+    uint64_t seed = 0;
+
+    void write_seed() const;
+
+public:
+    ParamManager params;
+    DiversityMonitor diversity;
+    DistributionMonitor distributions;
+    std::shared_ptr<const DemographicTables> tables;
+    std::mutex hostInfectionMutex; //Serialises host infection (two mosquitoes may bite the same host at once).
+
+    ModelContext() : diversity(params), distributions(params) {  }
+    ModelContext(const ModelContext&) = delete;
+    void operator=(const ModelContext&) = delete;
+
+    //Seeds one stream per thread from params.random_seed (or the clock if that is 0) and records the seed.
+    void initialise_random();
+
+    //Generates this run's PTABLEs, unless tables have already been set (e.g. shared with other runs of the same parameters).
+    void initialise_tables();
+
+    //Random number stream of the calling thread.
+    utilities::RandomStream& rng() { return rngs[utilities::thread_num()]; }
+    uint64_t get_seed() const { return seed; }
+
+    //Checkpointing: random number streams, the parameters adaptors change and the monitors. A run can only be resumed with as many
+    //threads as it was saved with, as each thread has its own stream. load() replaces initialise_random() and the monitors' reset().
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in);
+};
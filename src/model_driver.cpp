@@ -1,195 +1,509 @@
 #include "model_driver.hpp"
-#include "demographic_tools.hpp"
+#include "checkpoint.hpp"
+#include "model_context.hpp"
 #include "strain.hpp"
-#include "utilities.hpp"
-#include "param_manager.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <map>
 #include <vector>
 #include <omp.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 //toremove:
-#include "diversity_monitor.hpp"
 #include "testing.hpp"
 
 void ModelDriver::initialise_model()
 {
     std::cout << "initialising random number generator" << std::endl;
-    utilities::initialise_random();
+    ctx.initialise_random();
+    utilities::RandomStream& rng = ctx.rng();
+    ctx.diversity.reset();
+    ctx.distributions.reset();
 
     //Initialise PTABLEs.
     std::cout << "initialising PTABLEs" << std::endl;
-    pDeathHosts =  generate_host_ptable();
-    pDeathMosquitoes = generate_mosquito_ptable();
-    cdfHosts = calculate_host_cdf(pDeathHosts);
-    cdfMosquitoes = calculate_mosquito_cdf(pDeathMosquitoes);
+    ctx.initialise_tables();
+    const DemographicTables& tables = *ctx.tables;
 
     //Initialise hosts
     std::cout << "initialising host demographics" << std::endl;
-    hosts.reserve(ParamManager::num_hosts);
-    for (unsigned int h=0; h<ParamManager::num_hosts; ++h)
+    hosts.resize(ctx.params.num_hosts);
+
+    //Immune states are first written in HostPopulation::kill, so doing this with the same static schedule as the agent loops in run_model
+    //means each host's (large) immune state is first touched, and so placed on the NUMA node of, the thread that owns that host for the whole run.
+    #pragma omp parallel for schedule(static)
+    for (unsigned int b=0; b<hosts.num_blocks(); ++b)
     {
-        Host host;
-        host.kill();
-        host.age = random_host_equilibrum_age(cdfHosts);
-        hosts.push_back(host);
+        for (unsigned int h=hosts.block_begin(b); h<hosts.block_end(b); ++h)
+            hosts.kill(h);
     }
 
+    for (unsigned int h=0; h<hosts.size(); ++h)
+        hosts.set_age(h, random_host_equilibrum_age(rng, tables.cdfHosts));
+
     //Initialise mosquitoes
     std::cout << "initialising mosquito demographics" << std::endl;
-    mosquitoes.reserve(ParamManager::max_num_mosquitoes);
-    for (unsigned int m=0; m<ParamManager::initial_num_mosquitoes; ++m)
+    mosquitoes.allocate(ctx.params.max_num_mosquitoes);
+    for (unsigned int m=0; m<ctx.params.initial_num_mosquitoes; ++m)
     {
-        Mosquito mosquito;
-        mosquito.kill();
-        mosquito.age = random_mosquito_equilibrium_age(cdfMosquitoes);
-        mosquito.active = true;
-        mosquitoes.push_back(mosquito);
+        unsigned int iM = mosquitoes.add();
+        mosquitoes.set_age(iM, random_mosquito_equilibrium_age(rng, tables.cdfMosquitoes));
     }
 
-    mManager.initialise(&mosquitoes);
+    mManager.initialise(&ctx, &mosquitoes);
 
     //Create initial pool of strains
     std::vector<Strain> initialStrainPool;
-    if (ParamManager::unique_initial_strains == true)
+    if (ctx.params.unique_initial_strains == true)
         create_unique_initial_strains(initialStrainPool);
     else //randomly select initial strains and infections (default).
         create_random_initial_strains(initialStrainPool);
 
     //Initial infections (mosquitoes)
     std::cout << "initialising mosquito infections" << std::endl;
-    for (unsigned int i=0; i<ParamManager::initial_num_mosquito_infections; ++i)
+    for (unsigned int i=0; i<ctx.params.initial_num_mosquito_infections; ++i)
     {
         unsigned int iM = mManager.random_active_mos();
-        mosquitoes[iM].infect(initialStrainPool[i % initialStrainPool.size()], false);
+        mosquitoes.infect(iM, initialStrainPool[i % initialStrainPool.size()], false);
     }
 }
 
 void ModelDriver::run_model()
 {
-    initialise_model();
-    output.preinitialise_output_storage();
-
-    bool finished = false;
-    unsigned int timeElapsed = 0;
-    unsigned int timeNextOutput = ParamManager::output_interval;
-    unsigned int lastOutputInterval = ParamManager::output_interval;
-    output.append_output(timeElapsed, hosts, mosquitoes);
-    burnInPeriod = ParamManager::burn_in_period;
-    while (!finished)
-    {
-        //Dynamic parameters
-        ParamManager::update_adaptors(timeElapsed);
-        if (lastOutputInterval != ParamManager::output_interval) {
-            lastOutputInterval = ParamManager::output_interval;
-            timeNextOutput = timeElapsed;
-        }
+    const MemoryUsage projected = memory::project(ctx.params);
+    memory::print(std::cout, "Projected memory use (worst case)", projected);
+    if (ctx.params.dry_run)
+        return;
+
+    //Checked here because exceptions cannot propagate out of the parallel region below.
+    if (ctx.params.reintroduction_interval != 0 && !ctx.params.unique_initial_strains)
+        throw std::runtime_error("CANNOT REINTRODUCE INITIAL STRAINS: unique_initial_strains may be false, or intra/intergenic recombination may be non-zero.");
+
+    //Read before the burn-in, so that a bad scenario_file fails straight away.
+    std::vector<BranchScenario> scenarios;
+    if (!ctx.params.scenario_file.empty()) {
+        if (ctx.params.burn_in_period > ctx.params.run_time)
+            throw std::runtime_error("ModelDriver::run_model: scenarios branch at the end of the burn-in, so burn_in_period can't be longer than run_time.");
+        scenarios = branching::read_scenarios(ctx.params.scenario_file);
+    }
 
-        //Update output times
-        if (ParamManager::verbose) {
-            std::cout << "t=" << timeElapsed << "\n";
-            if (burnInPeriod > 0)
-                std::cout << "burnIn left: " << burnInPeriod << "\n";
-        }
-        else if (timeElapsed == timeNextOutput) {
-            std::cout << "t=" << timeElapsed << ". ";
-            if (burnInPeriod > 0)
-                std::cout << "burnIn left: " << burnInPeriod << ". ";
-        }
+    const bool resuming = !ctx.params.resume_from.empty();
+    if (resuming) {
+        load_checkpoint(ctx.params.resume_from);
+    }
+    else {
+        initialise_model();
+        output.preinitialise_output_storage();
+        timeElapsed = 0;
+        timeNextOutput = ctx.params.output_interval;
+        lastOutputInterval = ctx.params.output_interval;
+        burnInPeriod = ctx.params.burn_in_period;
+        audit.reset();
+        open_memory_file();
+    }
 
-        //tmp debug
-        //std::cout << timeElapsed << ": UniqueAntigens: " << DiversityMonitor::get_num_unique_antigens() << "\n";
+    const unsigned int endDay = scenarios.empty() ? ctx.params.run_time+1 : ctx.params.burn_in_period;
+    if (!scenarios.empty() && timeElapsed > endDay)
+        throw std::runtime_error("ModelDriver::run_model: resumed at t=" + std::to_string(timeElapsed) + ", after the end of the burn-in the scenarios branch from.");
 
-        //Host demographics
-        //std::cout << "aging hosts...\n";
-        #pragma omp barrier
-        age_hosts();
+    const unsigned int firstDay = timeElapsed;
+    simulate(endDay, !resuming); //Initial conditions are always output (a checkpoint is saved after the day's output).
+    finish_run(firstDay, projected.total());
 
-        //Mosquito demographics
-        //std::cout << "aging mosquitoes...\n";
-        #pragma omp barrier
-        age_mosquitoes();
+    if (!scenarios.empty())
+        run_scenarios(scenarios, projected.total());
+}
 
-        //Update infections in hosts
-        //std::cout << "updating host infections...\n";
-        #pragma omp barrier
-        update_host_infections();
+void ModelDriver::simulate(const unsigned int endDay, const bool outputFirst)
+{
+    bool finished = timeElapsed >= endDay;
+    bool outputDue = false;
+    bool auditDue = false;
+    profiler.reset(ctx.params.output_profile, ctx.params.profile_counters);
+    profiler.get_trace().reset(ctx.params.trace_first_day, ctx.params.trace_num_days, ctx.params.trace_buffer_events);
+
+    //The whole time loop runs inside one persistent team of threads. Anything that touches shared model state (time, adaptors,
+    //reintroduction) is done in a 'single' block; the agent loops are orphaned static worksharing loops, so each thread always owns
+    //the same range of hosts / mosquitoes (set OMP_PROC_BIND / OMP_PLACES to keep those threads on the same cores).
+    auto wallStart = std::chrono::steady_clock::now();
+    #pragma omp parallel default(shared)
+    {
+        //Initial conditions. Tests outputFirst rather than the shared outputDue, which the first thread into the loop may already have set for today.
+        if (outputFirst) {
+            profiler.start(PhaseProfiler::APPEND_OUTPUT);
+            output.append_output(timeElapsed, hosts, mosquitoes);
+            #pragma omp single
+            record_memory_usage(timeElapsed);
+            profiler.stop(PhaseProfiler::APPEND_OUTPUT, 1);
+        }
 
-        //Update infections in mosquitoes
-        //std::cout << "updating mosquito infections...\n";
-        #pragma omp barrier
-        update_mosquito_infections();
+        while (!finished)
+        {
+            profiler.get_trace().set_day(timeElapsed);
 
-        //mosquitoes feed
-        //std::cout << "feeding mosquitoes...\n";
-        #pragma omp barrier
-        feed_mosquitoes();
+            #pragma omp single nowait
+            {
+                profiler.start(PhaseProfiler::UPDATE_INFECTIONS);
 
-        //if appropriate, reintroduce an extinct initial strain.
-        #pragma omp barrier
-        attempt_reintroduction(timeElapsed);
+                //Dynamic parameters
+                ctx.params.update_adaptors(timeElapsed);
+                if (lastOutputInterval != ctx.params.output_interval) {
+                    lastOutputInterval = ctx.params.output_interval;
+                    timeNextOutput = timeElapsed;
+                }
+                outputDue = (timeElapsed == timeNextOutput);
+                auditDue = audit.is_due(timeElapsed);
 
-        //Update logging / data collection.
-        if (timeElapsed == timeNextOutput)
-        {
-            timeNextOutput = timeElapsed + ParamManager::output_interval;
-            output.append_output(timeElapsed, hosts, mosquitoes);
-        }
+                //Only infections which end today are visited, so this is cheap enough to do serially.
+                const unsigned int numCleared = update_infections(timeElapsed);
 
-        //Update time and check stop condition.
-        //std::cout << "incrementing time...\n";
-        if (burnInPeriod > 0)
-            --burnInPeriod;
+                //Update output times
+                if (ctx.params.verbose) {
+                    std::cout << "t=" << timeElapsed << "\n";
+                    if (burnInPeriod > 0)
+                        std::cout << "burnIn left: " << burnInPeriod << "\n";
+                }
+                else if (outputDue) {
+                    std::cout << "t=" << timeElapsed << ". ";
+                    if (burnInPeriod > 0)
+                        std::cout << "burnIn left: " << burnInPeriod << ". ";
+                }
+                profiler.stop(PhaseProfiler::UPDATE_INFECTIONS, numCleared);
+            }
+            profiler.barrier(PhaseProfiler::UPDATE_INFECTIONS); //Parameters (and the mosquito population size) are now fixed for the rest of the day.
+
+            //Host and mosquito demographics. These loops only touch the agent at the current index, so no barrier is needed between them.
+            profiler.start(PhaseProfiler::AGE_HOSTS);
+            const unsigned int numHostsAged = age_hosts();
+            profiler.stop(PhaseProfiler::AGE_HOSTS, numHostsAged);
+            profiler.start(PhaseProfiler::AGE_MOSQUITOES);
+            const unsigned int numMosquitoesAged = age_mosquitoes();
+            profiler.stop(PhaseProfiler::AGE_MOSQUITOES, numMosquitoesAged);
+
+            //Mosquitoes bite random hosts so every host must be up to date first.
+            profiler.barrier(PhaseProfiler::AGE_MOSQUITOES);
+            profiler.start(PhaseProfiler::FEED_MOSQUITOES);
+            const unsigned int numBites = feed_mosquitoes();
+            profiler.stop(PhaseProfiler::FEED_MOSQUITOES, numBites);
+            profiler.barrier(PhaseProfiler::FEED_MOSQUITOES);
+
+            //if appropriate, reintroduce an extinct initial strain.
+            #pragma omp single nowait
+            {
+                profiler.start(PhaseProfiler::ATTEMPT_REINTRODUCTION);
+                attempt_reintroduction(timeElapsed);
+                profiler.stop(PhaseProfiler::ATTEMPT_REINTRODUCTION);
+            }
+            profiler.barrier(PhaseProfiler::ATTEMPT_REINTRODUCTION);
+
+            //Check (and optionally repair) the diversity monitor's counts while no infections are changing.
+            if (auditDue)
+                audit.audit(timeElapsed, hosts, mosquitoes);
+
+            //Update logging / data collection.
+            if (outputDue) {
+                profiler.start(PhaseProfiler::APPEND_OUTPUT);
+                output.append_output(timeElapsed, hosts, mosquitoes);
+                #pragma omp single
+                record_memory_usage(timeElapsed); //Not nowait: timeElapsed is updated next.
+                profiler.stop(PhaseProfiler::APPEND_OUTPUT, 1);
+            }
 
-        ++timeElapsed;
-        if (timeElapsed > ParamManager::run_time)
-            finished = true;
+            //Update time and check stop condition.
+            #pragma omp single nowait
+            {
+                profiler.start(PhaseProfiler::UPDATE_TIME);
+                if (outputDue)
+                    timeNextOutput = timeElapsed + ctx.params.output_interval;
+
+                if (burnInPeriod > 0)
+                    --burnInPeriod;
+
+                ++timeElapsed;
+                if (timeElapsed >= endDay)
+                    finished = true;
+                profiler.stop(PhaseProfiler::UPDATE_TIME);
+
+                //Saved between days, so a resumed run starts at the top of the loop on day timeElapsed.
+                if (!finished && ctx.params.checkpoint_interval != 0 && timeElapsed % ctx.params.checkpoint_interval == 0) {
+                    profiler.start(PhaseProfiler::WRITE_CHECKPOINT);
+                    try {
+                        save_checkpoint(ctx.params.file_path()+ctx.params.run_name()+"_checkpoint.bin");
+                    }
+                    catch (const std::exception& e) { //Can't propagate out of the parallel region, and the run can carry on without it.
+                        std::cerr << "WARNING: checkpoint at t=" << timeElapsed << " not saved: " << e.what() << std::endl;
+                    }
+                    profiler.stop(PhaseProfiler::WRITE_CHECKPOINT);
+                }
+            }
+            profiler.barrier(PhaseProfiler::UPDATE_TIME); //Before 'finished' is read again.
+        }
+    }
+    std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - wallStart;
+    simulationSeconds = wallTime.count();
+}
 
-        #pragma omp barrier
+//Closes every file written as the run goes, so the state can be forked for scenarios afterwards.
+void ModelDriver::finish_run(const unsigned int firstDay, const uint64_t projectedBytes)
+{
+    const unsigned int daysSimulated = timeElapsed - firstDay;
+    std::cout << "Simulated " << daysSimulated << " days in " << simulationSeconds << "s (" << (1000000.0 * simulationSeconds / daysSimulated) << " us per day, "
+              << (daysSimulated / simulationSeconds) << " days per second)." << std::endl;
+
+    audit.close();
+    if (memoryFile.is_open()) {
+        memoryFile.close();
+        std::cout << "Peak RSS " << memory::format_bytes(memory::peak_rss()) << " (projected " << memory::format_bytes(projectedBytes) << ")." << std::endl;
     }
 
+    profiler.start(PhaseProfiler::EXPORT_OUTPUT);
     output.export_output();
+    profiler.stop(PhaseProfiler::EXPORT_OUTPUT);
+    if (profiler.is_enabled()) {
+        profiler.write(ctx.params.file_path()+ctx.params.run_name()+"_profile.csv", daysSimulated, simulationSeconds);
+        profiler.print_counter_summary();
+    }
+    if (profiler.get_trace().enabled())
+        profiler.get_trace().write(ctx.params.file_path()+ctx.params.run_name()+"_trace.json");
 }
 
-void ModelDriver::age_hosts()
+//Forks a process per scenario to carry the run on from here (see branching.hpp), max_concurrent_scenarios at a time, and waits for them.
+//Throws std::runtime_error, once every scenario has finished, if any failed.
+void ModelDriver::run_scenarios(const std::vector<BranchScenario>& scenarios, const uint64_t projectedBytes)
 {
-    #pragma omp parallel for
-    for (unsigned int i=0; i<hosts.size(); ++i)
+    const unsigned int maxConcurrent = ctx.params.max_concurrent_scenarios != 0 ? ctx.params.max_concurrent_scenarios : utilities::max_threads();
+    std::cout << "Branching " << scenarios.size() << " scenarios at t=" << timeElapsed << " (" << std::min<size_t>(maxConcurrent, scenarios.size())
+              << " at a time, each on one thread)." << std::endl;
+
+    auto wallStart = std::chrono::steady_clock::now();
+    std::map<pid_t, unsigned int> running; //Scenario index by process.
+    unsigned int next = 0;
+    unsigned int numFailed = 0;
+    while (next < scenarios.size() || !running.empty())
     {
-        hosts[i].age_host(pDeathHosts);
+        if (next < scenarios.size() && running.size() < maxConcurrent) {
+            std::cout.flush(); //Otherwise the child would write the buffered output again.
+            std::cerr.flush();
+            const pid_t pid = fork();
+            if (pid == 0)
+                _exit(run_scenario(scenarios[next], projectedBytes));
+            if (pid < 0) {
+                std::cerr << "scenario " << scenarios[next].name << ": fork() failed." << std::endl;
+                ++numFailed;
+            }
+            else {
+                running[pid] = next;
+                std::cout << "scenario " << scenarios[next].name << " started (pid " << pid << ")." << std::endl;
+            }
+            ++next;
+            continue;
+        }
+
+        int status = 0;
+        const pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+            break;
+        auto scenario = running.find(pid);
+        if (scenario == running.end())
+            continue;
+        const std::string& name = scenarios[scenario->second].name;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            std::cout << "scenario " << name << " finished." << std::endl;
+        else {
+            ++numFailed;
+            if (WIFSIGNALED(status))
+                std::cerr << "scenario " << name << " was killed by signal " << WTERMSIG(status) << "." << std::endl;
+            else
+                std::cerr << "scenario " << name << " failed (exit status " << WEXITSTATUS(status) << ")." << std::endl;
+        }
+        running.erase(scenario);
     }
+
+    std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - wallStart;
+    std::cout << "Ran " << scenarios.size() << " scenarios in " << wallTime.count() << "s." << std::endl;
+    if (numFailed != 0)
+        throw std::runtime_error("ModelDriver::run_scenarios: " + std::to_string(numFailed) + " of " + std::to_string(scenarios.size()) + " scenarios failed (see the errors above).");
 }
 
-void ModelDriver::age_mosquitoes()
+//Runs in the forked process: renames the run after the scenario, continues its files, applies its settings and runs on to run_time.
+int ModelDriver::run_scenario(const BranchScenario& scenario, const uint64_t projectedBytes)
 {
-    #pragma omp parallel for
-    for (unsigned int i=0; i<mosquitoes.size(); ++i)
-    {
-        if (mosquitoes[i].is_active())
-            mosquitoes[i].age_mosquito(pDeathMosquitoes);
+    const std::string burnInPrefix = ctx.params.file_path()+ctx.params.run_name();
+    ctx.params.runName = ctx.params.run_name() + "_" + scenario.name;
+    const std::string prefix = ctx.params.file_path()+ctx.params.run_name();
+    if (std::freopen((prefix+"_log.txt").c_str(), "w", stdout) == nullptr) //Scenarios run side by side, so their progress would be interleaved.
+        return 2;
+
+    try {
+        utilities::set_num_threads(1); //See branching.hpp.
+        branching::copy_file(burnInPrefix+"_seed.txt", prefix+"_seed.txt");
+        {
+            std::ofstream file(prefix+"_calling_arguments.txt", std::ofstream::out | std::ofstream::trunc);
+            std::ifstream burnInArguments(burnInPrefix+"_calling_arguments.txt");
+            if (burnInArguments.peek() != std::ifstream::traits_type::eof())
+                file << burnInArguments.rdbuf();
+            file << "\nscenario " << scenario.name << " (branched at t=" << timeElapsed << ")\n";
+            for (const std::pair<std::string, std::string>& setting : scenario.settings)
+                file << setting.first << " " << setting.second << "\n";
+        }
+
+        output.branch(burnInPrefix); //Before the settings, which may start new dynamic parameter series.
+        const unsigned int maxNumMosquitoes = ctx.params.max_num_mosquitoes;
+        for (const std::pair<std::string, std::string>& setting : scenario.settings)
+            branching::apply_setting(setting.first, setting.second, ctx, *this);
+        ctx.params.recalculate_derived_parameters();
+        if (ctx.params.max_num_mosquitoes != maxNumMosquitoes) //The mosquito population was allocated for the burn-in.
+            throw std::runtime_error("ModelDriver::run_scenario: needs room for " + std::to_string(ctx.params.max_num_mosquitoes) + " mosquitoes; set max_num_mosquitoes to at least that for the whole run.");
+        audit.branch(burnInPrefix, timeElapsed);
+        if (ctx.params.output_memory)
+            branching::continue_file(memoryFile, burnInPrefix+"_memory.csv", memory_filename());
+
+        const unsigned int firstDay = timeElapsed;
+        simulate(ctx.params.run_time+1, false); //The day's output (if due) and checkpoint were done before the branch.
+        finish_run(firstDay, projectedBytes);
     }
+    catch (const std::exception& e) {
+        std::cerr << "scenario " << scenario.name << ": " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout.flush();
+    return 0;
 }
 
-void ModelDriver::update_host_infections()
+MemoryUsage ModelDriver::memory_usage() const
 {
-    #pragma omp parallel for
-    for (unsigned int i=0; i<hosts.size(); ++i)
+    MemoryUsage usage;
+    usage.hosts = hosts.memory_bytes();
+    usage.mosquitoes = mosquitoes.memory_bytes();
+    usage.diversity = ctx.diversity.memory_bytes() + audit.memory_bytes();
+    usage.output = output.memory_bytes();
+    usage.strainStructure = output.strain_structure_memory_bytes();
+    return usage;
+}
+
+std::string ModelDriver::memory_filename() const
+{
+    return ctx.params.file_path()+ctx.params.run_name()+"_memory.csv";
+}
+
+void ModelDriver::open_memory_file()
+{
+    if (memoryFile.is_open())
+        memoryFile.close();
+    if (!ctx.params.output_memory)
+        return;
+    memoryFile.open(memory_filename(), std::ofstream::out | std::ofstream::trunc);
+    memoryFile << "time, hosts_bytes, mosquitoes_bytes, diversity_bytes, output_bytes, strain_structure_bytes, total_bytes, rss_bytes, peak_rss_bytes\n";
+}
+
+//Appends a line to _memory.csv (output_memory). Not thread safe.
+void ModelDriver::record_memory_usage(const unsigned int time)
+{
+    if (!memoryFile.is_open())
+        return;
+    const MemoryUsage usage = memory_usage();
+    memoryFile << time << ", " << usage.hosts << ", " << usage.mosquitoes << ", " << usage.diversity << ", " << usage.output << ", "
+               << usage.strainStructure << ", " << usage.total() << ", " << memory::current_rss() << ", " << memory::peak_rss() << "\n";
+}
+
+//Saves everything needed to carry on the run from the start of day timeElapsed. Not thread safe: call between days.
+void ModelDriver::save_checkpoint(const std::string& filename)
+{
+    checkpoint::Writer out;
+    out.open(filename);
+    out.section("DRVR");
+    out.write(timeElapsed);
+    out.write(timeNextOutput);
+    out.write(lastOutputInterval);
+    out.write(burnInPeriod);
+    out.write_vectors(cachedInitialStrainPool);
+    out.write(checkpoint::file_length(memoryFile));
+
+    ctx.save(out);
+    hosts.save(out);
+    mosquitoes.save(out);
+    mManager.save(out);
+    output.save(out);
+    audit.save(out);
+    out.section("END ");
+    out.close();
+}
+
+//Replaces initialise_model(), Output::preinitialise_output_storage() and DiversityAudit::reset() when resuming a run.
+void ModelDriver::load_checkpoint(const std::string& filename)
+{
+    auto loadStart = std::chrono::steady_clock::now();
+    std::cout << "resuming from " << filename << std::endl;
+    checkpoint::Reader in(filename);
+    in.section("DRVR");
+    in.read(timeElapsed);
+    in.read(timeNextOutput);
+    in.read(lastOutputInterval);
+    in.read(burnInPeriod);
+    in.read_vectors(cachedInitialStrainPool);
+    const uint64_t memoryFileLength = in.read<uint64_t>();
+
+    ctx.load(in);
+    ctx.initialise_tables();
+    hosts.load(in);
+    mosquitoes.load(in);
+    mManager.initialise(&ctx, &mosquitoes);
+    mManager.load(in);
+    output.load(in);
+    audit.load(in, timeElapsed);
+    in.section("END ");
+
+    if (memoryFileLength == 0)
+        open_memory_file();
+    else if (ctx.params.output_memory)
+        checkpoint::reopen(memoryFile, memory_filename(), memoryFileLength);
+
+    std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+    std::cout << "resumed at t=" << timeElapsed << " (loaded in " << loadTime.count() << "s)" << std::endl;
+}
+
+//The agent loops below are orphaned worksharing loops: they are called from inside run_model's parallel region and split their
+//iterations between its threads (or run serially if called from outside a parallel region). schedule(static) with the same
+//number of iterations always gives a thread the same range, which keeps agent data local to that thread.
+//Loops are split by population block (see HostPopulation / MosquitoPopulation), so a thread never shares a mosquito bitset word with another thread.
+unsigned int ModelDriver::age_hosts()
+{
+    unsigned int numAged = 0;
+    #pragma omp for schedule(static) nowait
+    for (unsigned int b=0; b<hosts.num_blocks(); ++b)
     {
-        hosts[i].update_infections();
+        hosts.age_block(b, ctx.tables->pDeathHosts);
+        numAged += hosts.block_end(b) - hosts.block_begin(b);
     }
+    return numAged;
 }
 
-void ModelDriver::update_mosquito_infections()
+unsigned int ModelDriver::age_mosquitoes()
 {
-    #pragma omp parallel for
-    for (unsigned int i=0; i<mosquitoes.size(); ++i)
+    unsigned int numAged = 0;
+    #pragma omp for schedule(static) nowait
+    for (unsigned int b=0; b<mosquitoes.num_blocks(); ++b)
     {
-        if (mosquitoes[i].is_active())
-            mosquitoes[i].update_infection();
+        mosquitoes.age_block(b, ctx.tables->pDeathMosquitoes);
+        numAged += mosquitoes.block_end(b) - mosquitoes.block_begin(b);
     }
+    return numAged;
 }
 
-void ModelDriver::feed_mosquitoes()
+//Clears the host infections which end on 'time' (a timing wheel lookup) and moves mosquitoes on to 'time', which is all that is needed
+//for those whose EIP ends today to start transmitting. Not a worksharing function: call from one thread.
+unsigned int ModelDriver::update_infections(const unsigned int time)
+{
+    const unsigned int numCleared = hosts.expire_infections(time);
+    mosquitoes.set_day(time);
+    return numCleared;
+}
+
+//No barrier at the end: the caller must wait for every thread before the hosts are used again.
+unsigned int ModelDriver::feed_mosquitoes()
 {
     bool allowRecombination;
     if (burnInPeriod <= 0)
@@ -197,23 +511,29 @@ void ModelDriver::feed_mosquitoes()
     else
         allowRecombination = false;
 
-    #pragma omp parallel for
-    for (unsigned int i=0; i<mosquitoes.size(); ++i)
+    utilities::RandomStream& rng = ctx.rng();
+    const BITE_FREQUENCY_TABLE& cumulativeBiteFrequencyDistribution = ctx.params.get_cumulative_bite_frequency_distribution();
+
+    unsigned int numBitesTotal = 0;
+    #pragma omp for schedule(static) nowait
+    for (unsigned int block=0; block<mosquitoes.num_blocks(); ++block)
     {
-        if (mosquitoes[i].is_active())
+        for (unsigned int i=mosquitoes.block_begin(block); i<mosquitoes.block_end(block); ++i)
         {
-            float p = utilities::random_float01()*ParamManager::get_cumulative_bite_frequency_distribution().back();
+            float p = rng.random_float01()*cumulativeBiteFrequencyDistribution.back();
             unsigned int numBites = 0;
-            while (p > ParamManager::get_cumulative_bite_frequency_distribution()[numBites])
+            while (p > cumulativeBiteFrequencyDistribution[numBites])
                 ++numBites;
+            numBitesTotal += numBites;
 
             for (unsigned int b=0; b<numBites; ++b)
             {
-                unsigned int iH = utilities::urandom(0, hosts.size());
-                mosquitoes[i].feed(hosts[iH], &output, allowRecombination);
+                unsigned int iH = rng.urandom(0, hosts.size());
+                mosquitoes.feed(i, hosts, iH, &output, allowRecombination);
             }
         }
     }
+    return numBitesTotal;
 }
 
 //Attempts to reintroduce a strain IF and only if it is time to do so
@@ -221,21 +541,21 @@ void ModelDriver::feed_mosquitoes()
 //Only reintroduces a strain if any of it's antigens are extinct
 void ModelDriver::attempt_reintroduction(const unsigned int time)
 {
-    if (ParamManager::reintroduction_interval != 0 && time % ParamManager::reintroduction_interval == 0)
+    if (ctx.params.reintroduction_interval != 0 && time % ctx.params.reintroduction_interval == 0)
     {
         //std::cout << "Attempting reintroduction at t=" << time << "\n";
-        if (ParamManager::unique_initial_strains)
+        if (ctx.params.unique_initial_strains)
         {
             //Choose a random initial strain and if it is extinct try to infect a random mosquito (only works if mosquito is uninfected).
-            unsigned int iS = utilities::random(0, cachedInitialStrainPool.size());
+            unsigned int iS = ctx.rng().random(0, cachedInitialStrainPool.size());
             Strain strain = cachedInitialStrainPool[iS];
 
             //If not extinct then ignore this...
             for (Antigen a : strain) {
-                if (DiversityMonitor::get_antigen_count(get_phenotype_id(strain[0])) == 0) {
+                if (ctx.diversity.get_antigen_count(get_phenotype_id(ctx.params, strain[0])) == 0) {
                     unsigned int iM = mManager.random_active_mos();
-                    if (mosquitoes[iM].is_infected() == false) {
-                        mosquitoes[iM].infect(cachedInitialStrainPool[iS], false, true);
+                    if (mosquitoes.is_infected(iM) == false) {
+                        mosquitoes.infect(iM, cachedInitialStrainPool[iS], false, true);
                         //std::cout << "Reintroduction successful!\n";
                     }
                 }
@@ -253,24 +573,24 @@ void ModelDriver::create_unique_initial_strains(std::vector<Strain>& _initialStr
     //Produce a random of all possible antigens
     std::cout << "initialising antigen pool" << std::endl;
     std::vector<Antigen> allAntigens;
-    for (unsigned int i=0; i<ParamManager::num_phenotypes; ++i)
-        allAntigens.push_back(i << ParamManager::num_genotype_only_bits);
-    std::random_shuffle(allAntigens.begin(), allAntigens.end());
+    for (unsigned int i=0; i<ctx.params.num_phenotypes; ++i)
+        allAntigens.push_back(i << ctx.params.num_genotype_only_bits);
+    std::shuffle(allAntigens.begin(), allAntigens.end(), ctx.rng());
 
     //Create (unique) strain list
     std::cout << "initialising strain pool" << std::endl;
-    _initialStrainPool.reserve(ParamManager::initial_num_strains);
+    _initialStrainPool.reserve(ctx.params.initial_num_strains);
     cachedInitialStrainPool.clear();
-    cachedInitialStrainPool.reserve(ParamManager::initial_num_strains);
+    cachedInitialStrainPool.reserve(ctx.params.initial_num_strains);
     unsigned int currentIndex=0;
-    for (unsigned int s=0; s<ParamManager::initial_num_strains; ++s)
+    for (unsigned int s=0; s<ctx.params.initial_num_strains; ++s)
     {
         Strain newStrain;
-        for (unsigned int i=0; i<ParamManager::repertoire_size; ++i)
+        for (unsigned int i=0; i<ctx.params.repertoire_size; ++i)
         {
-            if (currentIndex >= ParamManager::initial_antigen_diversity)
+            if (currentIndex >= ctx.params.initial_antigen_diversity)
             {
-                std::random_shuffle(allAntigens.begin(), allAntigens.begin()+ParamManager::initial_antigen_diversity);
+                std::shuffle(allAntigens.begin(), allAntigens.begin()+ctx.params.initial_antigen_diversity, ctx.rng());
                 currentIndex = 0;
             }
 
@@ -289,15 +609,15 @@ void ModelDriver::create_random_initial_strains(std::vector<Strain>& _initialStr
     //Generate initial pool of antigen diversity
     std::cout << "initialising antigen pool" << std::endl;
     std::vector<Antigen> initialAntigenPool;
-    initialAntigenPool.reserve(ParamManager::initial_antigen_diversity);
-    for (unsigned int a=0; a<ParamManager::initial_antigen_diversity; ++a)
-        initialAntigenPool.push_back(random_antigen() << ParamManager::num_genotype_only_bits); //turn antigen into gene
+    initialAntigenPool.reserve(ctx.params.initial_antigen_diversity);
+    for (unsigned int a=0; a<ctx.params.initial_antigen_diversity; ++a)
+        initialAntigenPool.push_back(random_antigen(ctx) << ctx.params.num_genotype_only_bits); //turn antigen into gene
 
     //Generate initial pool of strains from available initial antigen diversity
     std::cout << "initialising strain pool" << std::endl;
-    _initialStrainPool.reserve(ParamManager::initial_num_strains);
-    for (unsigned int s=0; s<ParamManager::initial_num_strains; ++s)
-        _initialStrainPool.push_back(strain_from_antigen_pool(initialAntigenPool));
+    _initialStrainPool.reserve(ctx.params.initial_num_strains);
+    for (unsigned int s=0; s<ctx.params.initial_num_strains; ++s)
+        _initialStrainPool.push_back(strain_from_antigen_pool(ctx, initialAntigenPool));
 }
 
 
@@ -305,31 +625,31 @@ void ModelDriver::create_random_initial_strains(std::vector<Strain>& _initialStr
 //temp todelete
 void ModelDriver::test()
 {
-    ParamManager::num_hosts = 10000;
-    ParamManager::initial_num_mosquitoes = 10000;
-    ParamManager::initial_num_mosquito_infections = 0;//10000;
-    ParamManager::unique_initial_strains = true;
-    ParamManager::intragenic_recombination_p = 0.0f;
-    ParamManager::intergenic_recombination_p = 0.0f;
-    ParamManager::num_phenotypes = 10000;
-    ParamManager::initial_antigen_diversity = 10000;
-    ParamManager::initial_num_strains = 1000;
-    ParamManager::recalculate_derived_parameters();
+    ctx.params.num_hosts = 10000;
+    ctx.params.initial_num_mosquitoes = 10000;
+    ctx.params.initial_num_mosquito_infections = 0;//10000;
+    ctx.params.unique_initial_strains = true;
+    ctx.params.intragenic_recombination_p = 0.0f;
+    ctx.params.intergenic_recombination_p = 0.0f;
+    ctx.params.num_phenotypes = 10000;
+    ctx.params.initial_antigen_diversity = 10000;
+    ctx.params.initial_num_strains = 1000;
+    ctx.params.recalculate_derived_parameters();
     initialise_model();
 
     unsigned int uniqueCount;
     unsigned int totalCount;
-    testing::long_diversity_count(uniqueCount, totalCount, hosts, mosquitoes);
+    testing::long_diversity_count(ctx.params, uniqueCount, totalCount, hosts, mosquitoes);
     std::cout << "Mosquitoes infected:\n";
     std::cout << "Long method: " << uniqueCount << "\t" << totalCount << "\n";
-    std::cout << "Quik method: " << DiversityMonitor::get_num_unique_antigens() << "\t" << DiversityMonitor::get_total_antigens() << "\n";
+    std::cout << "Quik method: " << ctx.diversity.get_num_unique_antigens() << "\t" << ctx.diversity.get_total_antigens() << "\n";
 
     for (unsigned int i=0; i<hosts.size(); ++i)
-        hosts[i].infect(cachedInitialStrainPool[utilities::random(0, cachedInitialStrainPool.size())]);
-    testing::long_diversity_count(uniqueCount, totalCount, hosts, mosquitoes);
+        hosts.infect(i, cachedInitialStrainPool[ctx.rng().random(0, cachedInitialStrainPool.size())]);
+    testing::long_diversity_count(ctx.params, uniqueCount, totalCount, hosts, mosquitoes);
     std::cout << "Mosquitoes+hosts infected:\n";
     std::cout << "Long method: " << uniqueCount << "\t" << totalCount << "\n";
-    std::cout << "Quik method: " << DiversityMonitor::get_num_unique_antigens() << "\t" << DiversityMonitor::get_total_antigens() << "\n";
+    std::cout << "Quik method: " << ctx.diversity.get_num_unique_antigens() << "\t" << ctx.diversity.get_total_antigens() << "\n";
 
 
     for (unsigned int i=0; i<10000; ++i)
@@ -337,18 +657,17 @@ void ModelDriver::test()
         age_hosts();
         //age_mosquitoes();
     }
-    testing::long_diversity_count(uniqueCount, totalCount, hosts, mosquitoes);
+    testing::long_diversity_count(ctx.params, uniqueCount, totalCount, hosts, mosquitoes);
     std::cout << "After loop host+mosquito:\n";
     std::cout << "Long method: " << uniqueCount << "\t" << totalCount << "\n";
-    std::cout << "Quik method: " << DiversityMonitor::get_num_unique_antigens() << "\t" << DiversityMonitor::get_total_antigens() << "\n";
+    std::cout << "Quik method: " << ctx.diversity.get_num_unique_antigens() << "\t" << ctx.diversity.get_total_antigens() << "\n";
 
     //age_hosts();
     //age_mosquitoes();
-    //update_host_infections();
-    //update_mosquito_infections();
+    //update_infections(0);
     //feed_mosquitoes();
 
 
-    //std::cout << "Counted unique antigens: " << uniqueAntigenCount << "\tIncremented antigens: " << DiversityMonitor::get_num_unique_antigens() << "\n";
-    //std::cout << "Counted total antigens:  " << antigenTotal << "\tIncremented antigens: " << DiversityMonitor::get_total_antigens() << "\n";
+    //std::cout << "Counted unique antigens: " << uniqueAntigenCount << "\tIncremented antigens: " << ctx.diversity.get_num_unique_antigens() << "\n";
+    //std::cout << "Counted total antigens:  " << antigenTotal << "\tIncremented antigens: " << ctx.diversity.get_total_antigens() << "\n";
 }
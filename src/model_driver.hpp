@@ -1,29 +1,55 @@
 #pragma once
-#include "host.hpp"
+#include "branching.hpp"
+#include "diversity_audit.hpp"
+#include "host_population.hpp"
+#include "memory_report.hpp"
 #include "output.hpp"
 #include "mosquito_manager.hpp"
+#include "phase_profiler.hpp"
+
+class ModelContext;
 
 class ModelDriver
 {
 private:
-    PTABLE pDeathHosts;
-    PTABLE pDeathMosquitoes;
-    PTABLE cdfHosts;
-    PTABLE cdfMosquitoes;
+    ModelContext& ctx;
 
-    std::vector<Host> hosts;
-    std::vector<Mosquito> mosquitoes;
+    HostPopulation hosts;
+    MosquitoPopulation mosquitoes;
     MosquitoManager mManager;
     float mosChangeRemainder = 0.0;
 
     Output output;
+    unsigned int timeElapsed = 0;
+    unsigned int timeNextOutput = 0;
+    unsigned int lastOutputInterval = 0; //To spot output_interval being changed by an adaptor.
     int burnInPeriod;
+    PhaseProfiler profiler;
+    DiversityAudit audit;
+    double simulationSeconds = 0.0; //Wall time of the last run's time loop.
+    std::ofstream memoryFile; //output_memory
+
+    MemoryUsage memory_usage() const; //Visits every strain, so O(hosts + mosquitoes).
+    std::string memory_filename() const;
+    void open_memory_file();
+    void record_memory_usage(const unsigned int time);
+
+    //Checkpoints (checkpoint_interval / resume_from): the whole model state, see checkpoint.hpp.
+    void save_checkpoint(const std::string& filename);
+    void load_checkpoint(const std::string& filename);
+
+    void simulate(const unsigned int endDay, const bool outputFirst); //Runs days timeElapsed to endDay-1, outputting the initial state first if asked to.
+    void finish_run(const unsigned int firstDay, const uint64_t projectedBytes); //Reports on, and writes the output of, the days simulated since firstDay.
+
+    //Scenario branching (scenario_file), see branching.hpp. run_scenario runs in the forked process and returns its exit status.
+    void run_scenarios(const std::vector<BranchScenario>& scenarios, const uint64_t projectedBytes);
+    int run_scenario(const BranchScenario& scenario, const uint64_t projectedBytes);
 
-    void age_hosts();
-    void age_mosquitoes();
-    void update_host_infections();
-    void update_mosquito_infections();
-    void feed_mosquitoes();
+    //The agent phases return the amount of work done by the calling thread (agents aged, infections cleared, bites), for the profiler.
+    unsigned int age_hosts();
+    unsigned int age_mosquitoes();
+    unsigned int update_infections(const unsigned int time);
+    unsigned int feed_mosquitoes();
     void attempt_reintroduction(const unsigned int elapsedTime);
     void update_parameters(const unsigned int time);
 
@@ -33,10 +59,12 @@ private:
     void create_unique_initial_strains(std::vector<Strain>& _initialStrainPool);
 
 public:
-    ModelDriver() : output(Output(this)) {  }
+    ModelDriver(ModelContext& ctx) : ctx(ctx), hosts(ctx), mosquitoes(ctx), output(ctx, this), audit(ctx) {  }
     void initialise_model();
     void run_model();
     MosquitoManager* get_mos_manager() {  return &mManager; }
+    double get_simulation_seconds() const { return simulationSeconds; }
+    void set_ensemble(EnsembleSummary* ensemble) { output.set_ensemble(ensemble); } //Summarise this run's output with other replicates' (ensemble_size).
 
     //temp
     void test();
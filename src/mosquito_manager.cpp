@@ -1,61 +1,37 @@
 #include "mosquito_manager.hpp"
-#include "utilities.hpp"
+#include "checkpoint.hpp"
+#include "model_context.hpp"
+#include <cstdlib>
+#include <iostream>
 
-void MosquitoManager::initialise(std::vector<Mosquito>* mosquitoesArray)
+void MosquitoManager::initialise(ModelContext* context, MosquitoPopulation* population)
 {
-    numMosquitoes = 0;
-    mosquitoes = mosquitoesArray;
-    activeMosquitoes.reserve(ParamManager::max_num_mosquitoes);
-    inactiveMosquitoes.reserve(ParamManager::max_num_mosquitoes);
-    for (unsigned int i=0; i<mosquitoes->size(); ++i)
-    {
-        if (mosquitoes->at(i).is_active())
-        {
-            activeMosquitoes.push_back(i);
-            numMosquitoes++;
-        }
-        else
-            inactiveMosquitoes.push_back(i);
-    }
+    ctx = context;
+    mosquitoes = population;
+    warnedFull = false;
 }
 
+//Removes randomly chosen mosquitoes.
 void MosquitoManager::remove_mosquito(unsigned int numToRemove)
 {
-    for (unsigned int i=0; i<numToRemove; ++i)
-    {
-        if (!activeMosquitoes.empty())
-        {
-            unsigned int iM = activeMosquitoes.back();
-            mosquitoes->at(iM).kill();
-            mosquitoes->at(iM).active = false;
-            activeMosquitoes.pop_back();
-            inactiveMosquitoes.push_back(iM);
-            --numMosquitoes;
-        }
-    }
+    for (unsigned int i=0; i<numToRemove && mosquitoes->size() > 0; ++i)
+        mosquitoes->remove(ctx->rng().random(0, mosquitoes->size()));
 }
+
+//Adds newborn, uninfected mosquitoes. The population can't grow past max_num_mosquitoes, which is its fixed capacity.
 void MosquitoManager::add_mosquito(unsigned int numToAdd)
 {
     for (unsigned int i=0; i<numToAdd; ++i)
     {
-        if (inactiveMosquitoes.empty()) //then we need to create a new mosquitoe...
+        if (mosquitoes->full())
         {
-            Mosquito newMosquito;
-            newMosquito.kill();
-            newMosquito.active = true;
-            mosquitoes->push_back(newMosquito);
-            activeMosquitoes.push_back(mosquitoes->size()-1);
-            numMosquitoes++;
-        }
-        else //inactive mosquito can be reactivated
-        {
-            unsigned int iM = inactiveMosquitoes.back();
-            mosquitoes->at(iM).kill();
-            mosquitoes->at(iM).active = true;
-            inactiveMosquitoes.pop_back();
-            activeMosquitoes.push_back(iM);
-            numMosquitoes++;
+            if (!warnedFull) {
+                std::cerr << "WARNING: MosquitoManager::add_mosquito: mosquito population is at max_num_mosquitoes (" << mosquitoes->capacity() << "), so no more can be added.\n";
+                warnedFull = true;
+            }
+            return;
         }
+        mosquitoes->add();
     }
 }
 
@@ -72,5 +48,17 @@ void MosquitoManager::modify_population(int numToChange)
 
 unsigned int MosquitoManager::random_active_mos() const
 {
-    return activeMosquitoes[utilities::random(0, activeMosquitoes.size())];
+    return ctx->rng().random(0, mosquitoes->size());
+}
+
+void MosquitoManager::save(checkpoint::Writer& out) const
+{
+    out.section("MMGR");
+    out.write<uint8_t>(warnedFull);
+}
+
+void MosquitoManager::load(checkpoint::Reader& in)
+{
+    in.section("MMGR");
+    warnedFull = in.read<uint8_t>();
 }
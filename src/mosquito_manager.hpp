@@ -1,21 +1,27 @@
 #pragma once
 
-#include "mosquito.hpp"
+#include "mosquito_population.hpp"
 #include <vector>
 
+namespace checkpoint { class Writer; class Reader; }
+
+//Changes the size of the mosquito population. MosquitoPopulation keeps active mosquitoes compacted at the front of its arrays, so
+//this only has to choose which mosquitoes are added or removed.
 class MosquitoManager
 {
 private:
-    unsigned int numMosquitoes=0;
-    std::vector<Mosquito>* mosquitoes;
-    std::vector<unsigned int> inactiveMosquitoes;
-    std::vector<unsigned int> activeMosquitoes;
+    ModelContext* ctx = nullptr;
+    MosquitoPopulation* mosquitoes;
+    bool warnedFull = false;
 
 public:
-    void initialise(std::vector<Mosquito>* mosquitoesArray);
-    unsigned int get_count() const { return numMosquitoes; }
+    void initialise(ModelContext* context, MosquitoPopulation* population);
+    unsigned int get_count() const { return mosquitoes->size(); }
     void remove_mosquito(unsigned int numToRemove = 1);
     void add_mosquito(unsigned int numToAdd = 1);
     void modify_population(int numToChange = 0); //Just selects remove_mosquito / add_mosquito as appropriate.
     unsigned int random_active_mos() const;
+
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in); //After initialise().
 };
@@ -0,0 +1,174 @@
+#include "mosquito_population.hpp"
+#include "checkpoint.hpp"
+#include "memory_report.hpp"
+#include "output.hpp"
+#include "model_context.hpp"
+
+void MosquitoPopulation::allocate(const unsigned int capacity)
+{
+    numActive = 0;
+    today = 0;
+    slotCapacity = capacity;
+    age.assign(capacity, 0);
+    infectiousDay.assign(capacity, 0);
+    infectedBits.assign((capacity+BLOCK_SIZE-1) / BLOCK_SIZE, 0);
+    strains.clear();
+    strains.resize(capacity);
+}
+
+uint64_t MosquitoPopulation::memory_bytes() const
+{
+    uint64_t bytes = memory::vector_bytes(age) + memory::vector_bytes(infectiousDay) + memory::vector_bytes(infectedBits) + memory::vector_bytes(strains);
+    for (const Strain& strain : strains)
+        bytes += memory::vector_bytes(strain);
+    return bytes;
+}
+
+void MosquitoPopulation::save(checkpoint::Writer& out) const
+{
+    out.section("MOSQ");
+    out.write(numActive);
+    out.write(slotCapacity);
+    out.write(today);
+    out.write_vector(age);
+    out.write_vector(infectiousDay);
+    out.write_vector(infectedBits);
+    out.write_vectors(strains);
+}
+
+void MosquitoPopulation::load(checkpoint::Reader& in)
+{
+    in.section("MOSQ");
+    in.read(numActive);
+    in.read(slotCapacity);
+    in.read(today);
+    in.read_vector(age);
+    in.read_vector(infectiousDay);
+    in.read_vector(infectedBits);
+    in.read_vectors(strains);
+}
+
+unsigned int MosquitoPopulation::add()
+{
+    //Slots past the end of the active range are always left dead (age 0, uninfected) by remove().
+    return numActive++;
+}
+
+void MosquitoPopulation::remove(const unsigned int i)
+{
+    kill(i);
+    --numActive;
+    if (i != numActive)
+        swap_slots(i, numActive);
+}
+
+void MosquitoPopulation::swap_slots(const unsigned int i, const unsigned int j)
+{
+    std::swap(age[i], age[j]);
+    std::swap(infectiousDay[i], infectiousDay[j]);
+    std::swap(strains[i], strains[j]); //Only swaps the vectors' pointers.
+
+    const bool iInfected = is_infected(i);
+    const bool jInfected = is_infected(j);
+    infectedBits[i/BLOCK_SIZE] = (infectedBits[i/BLOCK_SIZE] & ~bit(i)) | (jInfected ? bit(i) : 0);
+    infectedBits[j/BLOCK_SIZE] = (infectedBits[j/BLOCK_SIZE] & ~bit(j)) | (iInfected ? bit(j) : 0);
+}
+
+//Enacts infection event to a mosquito if possible. Assumes any probabilistic factors affecting infection chance have been accounted for and infection is still going ahead.
+void MosquitoPopulation::infect(const unsigned int i, const Strain& strain, bool allowRecombination, bool bypassGenerationRegister)
+{
+    if (is_infected(i) == false) //Can only be infected once.
+    {
+        infectedBits[i/BLOCK_SIZE] |= bit(i);
+        if (allowRecombination)
+            strains[i] = generate_recombinant_strain(ctx, strain);
+        else
+            strains[i] = strain;
+        ctx.diversity.register_new_strain(strains[i], bypassGenerationRegister);
+        infectiousDay[i] = today + ctx.params.mosquito_eip;
+    }
+}
+
+//killed and reborn
+void MosquitoPopulation::kill(const unsigned int i)
+{
+    age[i] = 0;
+    clear_infection(i);
+}
+
+void MosquitoPopulation::clear_infection(const unsigned int i)
+{
+    if (is_infected(i)) //register loss of antigen abundance
+    {
+        ctx.diversity.register_lost_strain(strains[i]);
+        infectedBits[i/BLOCK_SIZE] &= ~bit(i);
+    }
+}
+
+void MosquitoPopulation::feed(const unsigned int i, HostPopulation& hosts, const unsigned int iH, Output* output, bool allowRecombination)
+{
+    utilities::RandomStream& rng = ctx.rng();
+
+    ///Host infecting mosquito (only if not already infected)
+    if (is_infected(i) == false)
+    {
+        //If host has two infections then intergenic recombination occurs.
+        if (hosts.is_infected(iH, 0) && hosts.is_infected(iH, 1) && allowRecombination)
+        {
+            //Choose strain at random to be primary parent.
+            if (rng.urandom(0,2) == 0)
+                infect(i, generate_recombinant_strain(ctx, hosts.get_strain(iH, 0), hosts.get_strain(iH, 1)), allowRecombination);
+            else
+                infect(i, generate_recombinant_strain(ctx, hosts.get_strain(iH, 1), hosts.get_strain(iH, 0)), allowRecombination);
+        }
+        else if (hosts.is_infected(iH, 0) && rng.random_float01() < hosts.get_infectivity(iH, 0)) //Can only be one infection so no intergenic recombination.
+            infect(i, hosts.get_strain(iH, 0), allowRecombination);
+        else if (hosts.is_infected(iH, 1) && rng.random_float01() < hosts.get_infectivity(iH, 1)) //Can still only be one infection so no intergenic recombination.
+            infect(i, hosts.get_strain(iH, 1), allowRecombination);
+    }
+    ///Handle mosquito infecting host
+    else if (infectiousDay[i] <= today) //Mosquito was already infected, so transmit to host if infectious
+    {
+        hosts.infect(iH, strains[i]);
+        if (output != nullptr) //Count infectious bites (to calculate EIR)
+            output->register_infectious_bite();
+    }
+}
+
+void MosquitoPopulation::age_block(const unsigned int block, const PTABLE& pDeath)
+{
+    utilities::RandomStream& rng = ctx.rng();
+    const unsigned int begin = block_begin(block);
+    const unsigned int n = block_end(block) - begin;
+
+    //Random numbers are drawn first so the update loop below has no loop carried dependency and can be vectorised.
+    float draws[BLOCK_SIZE];
+    for (unsigned int j=0; j<n; ++j)
+        draws[j] = rng.random_float01();
+
+    uint16_t* blockAge = &age[begin];
+    uint8_t dies[BLOCK_SIZE];
+    for (unsigned int j=0; j<n; ++j)
+    {
+        const unsigned int a = std::min<unsigned int>(blockAge[j], pDeath.size()-1);
+        dies[j] = draws[j] < pDeath[a];
+        blockAge[j] = dies[j] ? 0 : blockAge[j]+1;
+    }
+
+    //Dead mosquitoes are replaced by uninfected newborns, so only the infected ones need any more work.
+    uint64_t died = 0;
+    for (unsigned int j=0; j<n; ++j)
+        died |= (uint64_t)dies[j] << j;
+
+    uint64_t diedInfected = died & infectedBits[block];
+    while (diedInfected != 0)
+    {
+        clear_infection(begin + __builtin_ctzll(diedInfected));
+        diedInfected &= diedInfected-1; //Clear lowest set bit.
+    }
+}
+
+unsigned int MosquitoPopulation::count_infected_block(const unsigned int block) const
+{
+    return __builtin_popcountll(infectedBits[block]);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "host_population.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class Output;
+class ModelContext;
+
+//Structure of arrays store for the mosquito population. The daily loop only touches the small hot arrays (age and the infected bitset).
+//Strains are cold data which is only read or written when a mosquito feeds or dies. The end of the EIP is stored as a day, so nothing
+//needs doing when a mosquito becomes infectious.
+//Storage has a fixed capacity and active mosquitoes are kept compacted in [0, size()), so loops never visit inactive slots and
+//nothing is reallocated during a run. Slots are grouped into blocks of 64 (one bitset word). Each block is processed by one thread,
+//so bits can be set without atomics.
+class MosquitoPopulation
+{
+public:
+    static const unsigned int BLOCK_SIZE = 64;
+
+private:
+    ModelContext& ctx;
+    unsigned int numActive = 0;
+    unsigned int slotCapacity = 0;
+    unsigned int today = 0;
+
+    //Hot
+    std::vector<uint16_t> age; //In days.
+    std::vector<uint32_t> infectiousDay; //Day an infected mosquito becomes infectious (end of EIP).
+    std::vector<uint64_t> infectedBits; //Inactive slots are always uninfected.
+
+    //Cold
+    std::vector<Strain> strains; //The slot index is the strain handle. Each strain keeps its capacity between infections.
+
+    static uint64_t bit(const unsigned int i) { return (uint64_t)1 << (i % BLOCK_SIZE); }
+    void clear_infection(const unsigned int i);
+    void swap_slots(const unsigned int i, const unsigned int j);
+
+public:
+    MosquitoPopulation(ModelContext& _ctx) : ctx(_ctx) {  }
+
+    void allocate(const unsigned int capacity); //Removes every mosquito and sets the fixed capacity.
+    unsigned int add(); //Activates a newborn, uninfected mosquito and returns its index. Must not be called when full().
+    void remove(const unsigned int i); //Swaps the last active mosquito into slot i, so indices >= i are invalidated.
+
+    unsigned int size() const { return numActive; }
+    unsigned int capacity() const { return slotCapacity; }
+    bool full() const { return numActive == slotCapacity; }
+    uint64_t memory_bytes() const; //Visits every strain, so O(capacity).
+    unsigned int num_blocks() const { return (numActive+BLOCK_SIZE-1) / BLOCK_SIZE; }
+    unsigned int block_begin(const unsigned int block) const { return block*BLOCK_SIZE; }
+    unsigned int block_end(const unsigned int block) const { return std::min((block+1)*BLOCK_SIZE, numActive); }
+
+    bool is_infected(const unsigned int i) const { return infectedBits[i/BLOCK_SIZE] & bit(i); }
+    bool is_infectious(const unsigned int i) const { return is_infected(i) && infectiousDay[i] <= today; }
+    unsigned int get_age(const unsigned int i) const { return age[i]; }
+    unsigned int get_eip_remaining(const unsigned int i) const { return is_infected(i) && infectiousDay[i] > today ? infectiousDay[i] - today : 0; }
+    const Strain& get_strain(const unsigned int i) const { return strains[i]; }
+
+    void set_age(const unsigned int i, const unsigned int newAge) { age[i] = newAge; }
+    void set_day(const unsigned int day) { today = day; }
+
+    void infect(const unsigned int i, const Strain& strain, bool allowRecombination, bool bypassGenerationRegister = false); //bypassGenerationRegister prevents antigens being registered as newly generated antigens
+    void kill(const unsigned int i); //killed and reborn
+    void feed(const unsigned int i, HostPopulation& hosts, const unsigned int iH, Output* output = nullptr, bool allowRecombination = true);
+
+    //Daily update over one block. Only one thread may work on a block at a time.
+    void age_block(const unsigned int block, const PTABLE& pDeath);
+    unsigned int count_infected_block(const unsigned int block) const;
+
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in); //In place of allocate(), restoring the capacity too.
+};
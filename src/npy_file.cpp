@@ -0,0 +1,154 @@
+#include "npy_file.hpp"
+#include <array>
+#include <sstream>
+
+namespace
+{
+    template <typename T>
+    void write_value(std::ofstream& file, const T value) { file.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    std::array<uint32_t, 256> make_crc32_table()
+    {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i=0; i<256; ++i)
+        {
+            uint32_t c = i;
+            for (unsigned int k=0; k<8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }
+
+    //Standard (zip / zlib) CRC-32, continuing from crc.
+    uint32_t crc32(uint32_t crc, const void* data, const uint64_t bytes)
+    {
+        static const std::array<uint32_t, 256> table = make_crc32_table(); //Initialised once even if ensemble replicates export at the same time.
+
+        const unsigned char* bytePtr = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+        for (uint64_t i=0; i<bytes; ++i)
+            crc = table[(crc ^ bytePtr[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    const uint16_t ZIP_VERSION = 20;
+    const uint16_t ZIP_DOS_DATE = (1 << 5) | 1; //1980-01-01, the earliest a zip can record.
+}
+
+namespace npy
+{
+
+std::string preamble(const char* dtype, const std::vector<uint64_t>& shape)
+{
+    std::ostringstream dict;
+    dict << "{'descr': '" << dtype << "', 'fortran_order': False, 'shape': (";
+    for (uint64_t dim : shape)
+        dict << dim << ", ";
+    dict << "), }";
+
+    std::string header = dict.str();
+    const size_t unpadded = 10 + header.size() + 1; //magic+version+length, header, '\n'
+    header.append((64 - unpadded%64) % 64, ' ');
+    header.push_back('\n');
+
+    std::string out("\x93NUMPY\x01\x00", 8);
+    out.push_back(header.size() & 0xFF);
+    out.push_back(header.size() >> 8);
+    return out + header;
+}
+
+void save(const std::string& filename, const char* dtype, const std::vector<uint64_t>& shape, const void* data, const uint64_t bytes)
+{
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    if (!file.is_open())
+        throw std::runtime_error("npy::save: could not open '" + filename + "'.");
+
+    const std::string header = preamble(dtype, shape);
+    file.write(header.data(), header.size());
+    file.write(static_cast<const char*>(data), bytes);
+}
+
+
+void ZipWriter::open(const std::string& filename)
+{
+    file.open(filename, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    if (!file.is_open())
+        throw std::runtime_error("npy::ZipWriter: could not open '" + filename + "'.");
+    entries.clear();
+}
+
+void ZipWriter::add(const std::string& name, const char* dtype, const std::vector<uint64_t>& shape, const void* data, const uint64_t bytes)
+{
+    const std::string header = preamble(dtype, shape);
+    const uint64_t offset = file.tellp();
+    if (header.size() + bytes > 0xFFFFFFFFu || offset > 0xFFFFFFFFu) //Would need zip64 extensions.
+        throw std::runtime_error("npy::ZipWriter: '" + name + "' takes the archive past 4GB, use output_format npy instead.");
+
+    Entry entry;
+    entry.name = name + ".npy";
+    entry.crc = crc32(crc32(0, header.data(), header.size()), data, bytes);
+    entry.size = header.size() + bytes;
+    entry.offset = offset;
+
+    //Local file header
+    write_value<uint32_t>(file, 0x04034b50);
+    write_value<uint16_t>(file, ZIP_VERSION);
+    write_value<uint16_t>(file, 0); //flags
+    write_value<uint16_t>(file, 0); //stored
+    write_value<uint16_t>(file, 0); //time
+    write_value<uint16_t>(file, ZIP_DOS_DATE);
+    write_value<uint32_t>(file, entry.crc);
+    write_value<uint32_t>(file, entry.size); //compressed
+    write_value<uint32_t>(file, entry.size); //uncompressed
+    write_value<uint16_t>(file, entry.name.size());
+    write_value<uint16_t>(file, 0); //extra field length
+    file.write(entry.name.data(), entry.name.size());
+
+    file.write(header.data(), header.size());
+    file.write(static_cast<const char*>(data), bytes);
+    entries.push_back(entry);
+}
+
+void ZipWriter::close()
+{
+    if (!file.is_open())
+        return;
+
+    const uint64_t directoryOffset = file.tellp();
+    for (const Entry& entry : entries)
+    {
+        write_value<uint32_t>(file, 0x02014b50);
+        write_value<uint16_t>(file, ZIP_VERSION); //made by
+        write_value<uint16_t>(file, ZIP_VERSION); //needed to extract
+        write_value<uint16_t>(file, 0);
+        write_value<uint16_t>(file, 0);
+        write_value<uint16_t>(file, 0);
+        write_value<uint16_t>(file, ZIP_DOS_DATE);
+        write_value<uint32_t>(file, entry.crc);
+        write_value<uint32_t>(file, entry.size);
+        write_value<uint32_t>(file, entry.size);
+        write_value<uint16_t>(file, entry.name.size());
+        write_value<uint16_t>(file, 0); //extra field length
+        write_value<uint16_t>(file, 0); //comment length
+        write_value<uint16_t>(file, 0); //disk number
+        write_value<uint16_t>(file, 0); //internal attributes
+        write_value<uint32_t>(file, 0); //external attributes
+        write_value<uint32_t>(file, entry.offset);
+        file.write(entry.name.data(), entry.name.size());
+    }
+    const uint64_t directorySize = (uint64_t)file.tellp() - directoryOffset;
+
+    //End of central directory record
+    write_value<uint32_t>(file, 0x06054b50);
+    write_value<uint16_t>(file, 0);
+    write_value<uint16_t>(file, 0);
+    write_value<uint16_t>(file, entries.size());
+    write_value<uint16_t>(file, entries.size());
+    write_value<uint32_t>(file, directorySize);
+    write_value<uint32_t>(file, directoryOffset);
+    write_value<uint16_t>(file, 0); //comment length
+    file.close();
+}
+
+}
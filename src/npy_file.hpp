@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Writes numpy's native formats (output_format npy / npz), so output can be loaded without parsing, e.g. np.load(f, mmap_mode='r').
+//  .npy: "\x93NUMPY" version 1.0, a python dict literal header (dtype, shape), then the raw little endian C order data.
+//  .npz: a zip archive of .npy files. Written uncompressed (stored), so no zlib is needed.
+namespace npy
+{
+    template <typename T> struct Dtype;
+    template <> struct Dtype<float> { static const char* str() { return "<f4"; } };
+    template <> struct Dtype<uint32_t> { static const char* str() { return "<u4"; } };
+
+    //The .npy preamble: magic, version, header length and header, padded so the data starts on a 64 byte boundary.
+    std::string preamble(const char* dtype, const std::vector<uint64_t>& shape);
+
+    void save(const std::string& filename, const char* dtype, const std::vector<uint64_t>& shape, const void* data, const uint64_t bytes);
+
+    template <typename T>
+    void save(const std::string& filename, const std::vector<T>& data, const std::vector<uint64_t>& shape)
+    {
+        save(filename, Dtype<T>::str(), shape, data.data(), data.size()*sizeof(T));
+    }
+
+    template <typename T>
+    void save(const std::string& filename, const std::vector<T>& data) { save(filename, data, {data.size()}); }
+
+    //Builds an .npz file one array at a time. Arrays are loaded by name (without the .npy) from the NpzFile numpy returns.
+    class ZipWriter
+    {
+    private:
+        struct Entry
+        {
+            std::string name;
+            uint32_t crc;
+            uint32_t size;
+            uint32_t offset;
+        };
+
+        std::ofstream file;
+        std::vector<Entry> entries;
+
+    public:
+        void open(const std::string& filename);
+        void add(const std::string& name, const char* dtype, const std::vector<uint64_t>& shape, const void* data, const uint64_t bytes);
+        void close(); //Writes the central directory.
+
+        template <typename T>
+        void add(const std::string& name, const std::vector<T>& data, const std::vector<uint64_t>& shape)
+        {
+            add(name, Dtype<T>::str(), shape, data.data(), data.size()*sizeof(T));
+        }
+
+        template <typename T>
+        void add(const std::string& name, const std::vector<T>& data) { add(name, data, {data.size()}); }
+    };
+}
@@ -1,28 +1,59 @@
 #include "output.hpp"
-#include "diversity_monitor.hpp"
+#include "branching.hpp"
+#include "checkpoint.hpp"
+#include "columnar_file.hpp"
+#include "ensemble.hpp"
+#include "memory_report.hpp"
+#include "model_context.hpp"
 #include "model_driver.hpp"
+#include "npy_file.hpp"
 #include "strain.hpp"
-#include "utilities.hpp"
 #include <cmath>
+#include <fstream>
 #include <sstream>
 #include <numeric>
-#include <unordered_map>
-#include <sys/stat.h>
-#include <sys/types.h>
 #include <omp.h>
 
 //tmp
 #include "testing.hpp"
 
 
+namespace
+{
+    const std::vector<double> QUANTILES = {0.05, 0.25, 0.5, 0.75, 0.95};
+    const char* QUANTILE_NAMES[] = {"p5", "p25", "p50", "p75", "p95"};
+}
+
+Output::Output(ModelContext& _ctx, ModelDriver* _model) : ctx(_ctx), model(_model), strainCensus(_ctx.params)
+{
+}
+
 void Output::preinitialise_output_storage()
 {
     curNumInfectiousBites = 0;
     cumulativeOutputCount = 0;
     lastUpdateTime = -1;
 
+    antigenFrequency.reset(ctx.params.num_phenotypes);
+    if (ctx.params.output_antigen_frequency && ctx.params.sparse_antigen_frequency)
+        antigenFrequencyChangesFile.open(ctx.params.file_path()+ctx.params.run_name()+"_circulating_antigen_frequency_changes.csv", std::ofstream::out | std::ofstream::trunc);
+
+    if (ctx.params.output_distributions)
+        hostImmunitySketches.assign(utilities::max_threads(), ThreadSketch());
+
+    if (ctx.params.output_strain_structure)
+        strainCensus.open(ctx.params.file_path()+ctx.params.run_name()+"_strain_structure.tdmc", run_header(ctx.params.run_name(), ctx.params.file_path()));
+
+    if (ctx.params.output_top_antigens > 0)
+        topAntigensFile.open(ctx.params.file_path()+ctx.params.run_name()+"_top_antigens.csv", std::ofstream::out | std::ofstream::trunc);
+
+    if (ctx.params.stream_output) {
+        open_stream(ctx.params.run_name(), ctx.params.file_path());
+        return; //Only the latest output is ever held in memory.
+    }
+
     //unsigned int sizeNeeded = (numTimeSteps / outputInterval)+1; //+1 for initial conditions
-    unsigned int sizeNeeded = ParamManager::output_size_needed;
+    unsigned int sizeNeeded = ctx.params.output_size_needed;
 
 
     timeLog.reserve(sizeNeeded);
@@ -32,75 +63,313 @@ void Output::preinitialise_output_storage()
     eir.reserve(sizeNeeded);
     proportionCirculatingAntigens.reserve(sizeNeeded);
     shannonEntropy.reserve(sizeNeeded);
+    simpsonDiversity.reserve(sizeNeeded);
+    chao1Richness.reserve(sizeNeeded);
     absoluteImmunity.reserve(sizeNeeded);
     antigenGenerationRate.reserve(sizeNeeded);
     antigenLossRate.reserve(sizeNeeded);
 
-    if (ParamManager::output_antigen_frequency)
-        antigenFrequency.reserve(sizeNeeded);
-
-    if (ParamManager::output_host_susceptibility)
+    if (ctx.params.output_host_susceptibility)
         hostSusceptibility.reserve(sizeNeeded);
 
+    if (ctx.params.output_top_antigens > 0)
+        topAntigensBound.reserve(sizeNeeded);
+
 //    if (ParamManager::instance().get_bool("output_parasite_adaptedness"))
 //        parasiteAdaptedness.reserve(sizeNeeded);
 
-    if (ParamManager::dyn_num_mosquitoes)
+    if (ctx.params.dyn_num_mosquitoes)
         numMosquitoesList.reserve(sizeNeeded);
 
-    if (ParamManager::dyn_bite_rate)
+    if (ctx.params.dyn_bite_rate)
         biteRateList.reserve(sizeNeeded);
 
-    if (ParamManager::dyn_intragenic_recombination_p)
+    if (ctx.params.dyn_intragenic_recombination_p)
         intragenicRecombinationPList.reserve(sizeNeeded);
 }
 
+//Must be called by every thread when called from inside a parallel region (ModelDriver::run_model): the per agent metrics are
+//calculated with orphaned worksharing loops and everything else is done by a single thread.
 void Output::append_output(const unsigned int timestep, const Hosts& hosts, const Mosquitoes& mosquitoes)
 {
     calc_host_dependent_metrics(hosts);
     calc_mosquito_dependent_metrics(mosquitoes);
     calc_host_mosquito_dependent_metrics(hosts, mosquitoes);
-    calc_time_dependent_metrics(timestep);
-    calc_dyn_metrics();
-
     process_strain_structure_output(hosts, mosquitoes);
 
-    lastUpdateTime = timestep;
-    ++cumulativeOutputCount;
+    #pragma omp single
+    {
+        calc_time_dependent_metrics(timestep);
+        calc_dyn_metrics();
+        calc_distribution_metrics();
+        if (ensemble != nullptr)
+            ensemble->add(cumulativeOutputCount, get_series());
+
+        lastUpdateTime = timestep;
+        ++cumulativeOutputCount;
+
+        ctx.diversity.reset_loss_gen_count();
+
+        if (stream)
+            stream_latest_output();
+    }
+}
+
+//Clears the shared partial sums used to combine each thread's contribution to a metric. Includes a barrier (end of single).
+void Output::reset_partial_sums()
+{
+    #pragma omp single
+    partialSums.fill(0.0);
+}
+
+//Adds this thread's contribution to partialSums[i]. The team total is available after the next barrier.
+void Output::add_partial_sum(const unsigned int i, const double value)
+{
+    #pragma omp atomic
+    partialSums[i] += value;
+}
 
-    DiversityMonitor::reset_loss_gen_count();
+void Output::export_output()
+{
+    export_output(ctx.params.run_name(), ctx.params.file_path());
 }
 
 void Output::export_output(const std::string runName, const std::string filePath)
 {
-    utilities::arrayToFile(timeLog, filePath+runName+"_timesteps.csv");
-    utilities::arrayToFile(hPrevalence, filePath+runName+"_host_prevalences.csv");
-    utilities::arrayToFile(mPrevalence, filePath+runName+"_mosquito_prevalences.csv");
-    utilities::arrayToFile(moi, filePath+runName+"_moi.csv");
-    utilities::arrayToFile(eir, filePath+runName+"_eir.csv");
-    utilities::arrayToFile(proportionCirculatingAntigens, filePath+runName+"_num_circulating_antigens.csv");
-    utilities::arrayToFile(shannonEntropy, filePath+runName+"_shannon_entropy_diversity.csv");
-    utilities::arrayToFile(absoluteImmunity, filePath+runName+"_absolute_immunity.csv");
-    utilities::arrayToFile(antigenGenerationRate, filePath+runName+"_antigen_generation_rate.csv");
-    utilities::arrayToFile(antigenLossRate, filePath+runName+"_antigen_loss_rate.csv");
-
-    if (ParamManager::output_antigen_frequency)
-        utilities::matrixToFile(antigenFrequency, filePath+runName+"_circulating_antigen_frequency.csv", ", ");
-
-    if (ParamManager::output_host_susceptibility)
-        utilities::arrayToFile(hostSusceptibility, filePath+runName+"_host_susceptibility.csv");
+    if (antigenFrequencyChangesFile.is_open())
+        antigenFrequencyChangesFile.close();
+    if (topAntigensFile.is_open())
+        topAntigensFile.close();
+    if (strainCensus.is_open())
+        strainCensus.close();
+
+    //Everything has already been written, so just wait for the writer to finish.
+    if (stream) {
+        stream->close();
+        stream.reset();
+        return;
+    }
+
+    if (ctx.params.output_format == "binary") {
+        export_binary_output(runName, filePath);
+        return;
+    }
+    else if (ctx.params.output_format == "npy" || ctx.params.output_format == "npz") {
+        export_npy_output(runName, filePath, ctx.params.output_format == "npz");
+        return;
+    }
+
+    for (const Series& series : get_series())
+    {
+        if (series.floats != nullptr)
+            utilities::arrayToFile(*series.floats, filePath+runName+"_"+series.name+".csv");
+        else
+            utilities::arrayToFile(*series.uints, filePath+runName+"_"+series.name+".csv");
+    }
+
+    if (dense_antigen_frequency())
+        write_antigen_frequency_csv(filePath+runName+"_circulating_antigen_frequency.csv");
 
 //    if (ParamManager::instance().get_bool("output_parasite_adaptedness"))
 //        utilities::arrayToFile(parasiteAdaptedness, filePath+runName+"_parasite_adaptedness.csv");
+}
 
-    if (ParamManager::dyn_num_mosquitoes)
-        utilities::arrayToFile(numMosquitoesList, filePath+runName+"_num_mosquitoes.csv");
+bool Output::dense_antigen_frequency() const
+{
+    return ctx.params.output_antigen_frequency && !ctx.params.sparse_antigen_frequency;
+}
+
+//One row per antigen, one column per output time, as utilities::matrixToFile wrote it. Written straight from the change history.
+void Output::write_antigen_frequency_csv(const std::string& filename) const
+{
+    std::ofstream file;
+    file.open(filename, std::ofstream::out | std::ofstream::trunc);
+
+    antigenFrequency.for_each_column([&file](const uint32_t antigen, const std::vector<uint32_t>& frequencies) {
+        for (unsigned int t=0; t<frequencies.size(); ++t)
+        {
+            if (t != 0)
+                file << ", ";
+            file << frequencies[t];
+        }
+        file << "\n";
+    });
+
+    file.flush();
+    file.close();
+}
+
+std::vector<unsigned int> Output::antigen_frequency_matrix() const
+{
+    std::vector<unsigned int> matrix;
+    matrix.reserve(antigenFrequency.num_rows()*antigenFrequency.get_width());
+    antigenFrequency.for_each_row([&matrix](const std::vector<uint32_t>& row) { matrix.insert(matrix.end(), row.begin(), row.end()); });
+    return matrix;
+}
+
+//Every time series which is output, in file order. The name is used for the CSV file name suffix and the binary column name.
+std::vector<Output::Series> Output::get_series() const
+{
+    std::vector<Series> series;
+    series.push_back(Series{"timesteps", nullptr, &timeLog});
+    series.push_back(Series{"host_prevalences", &hPrevalence, nullptr});
+    series.push_back(Series{"mosquito_prevalences", &mPrevalence, nullptr});
+    series.push_back(Series{"moi", &moi, nullptr});
+    series.push_back(Series{"eir", &eir, nullptr});
+    series.push_back(Series{"num_circulating_antigens", &proportionCirculatingAntigens, nullptr});
+    series.push_back(Series{"shannon_entropy_diversity", &shannonEntropy, nullptr});
+    series.push_back(Series{"simpson_diversity", &simpsonDiversity, nullptr});
+    series.push_back(Series{"chao1_richness", &chao1Richness, nullptr});
+    series.push_back(Series{"absolute_immunity", &absoluteImmunity, nullptr});
+    series.push_back(Series{"antigen_generation_rate", &antigenGenerationRate, nullptr});
+    series.push_back(Series{"antigen_loss_rate", &antigenLossRate, nullptr});
+
+    if (ctx.params.output_host_susceptibility)
+        series.push_back(Series{"host_susceptibility", &hostSusceptibility, nullptr});
+
+    if (ctx.params.output_top_antigens > 0)
+        series.push_back(Series{"top_antigens_bound", nullptr, &topAntigensBound});
+
+    if (ctx.params.output_distributions) {
+        for (unsigned int q=0; q<NUM_QUANTILES; ++q)
+            series.push_back(Series{std::string("infection_duration_")+QUANTILE_NAMES[q], &infectionDurationQuantiles[q], nullptr});
+        for (unsigned int q=0; q<NUM_QUANTILES; ++q)
+            series.push_back(Series{std::string("host_age_at_infection_")+QUANTILE_NAMES[q], &hostAgeAtInfectionQuantiles[q], nullptr});
+        for (unsigned int q=0; q<NUM_QUANTILES; ++q)
+            series.push_back(Series{std::string("host_immunity_")+QUANTILE_NAMES[q], &hostImmunityQuantiles[q], nullptr});
+    }
+
+    if (ctx.params.dyn_num_mosquitoes)
+        series.push_back(Series{"num_mosquitoes", nullptr, &numMosquitoesList});
+
+    if (ctx.params.dyn_bite_rate)
+        series.push_back(Series{"bite_rate", &biteRateList, nullptr});
 
-    if (ParamManager::dyn_bite_rate)
-        utilities::arrayToFile(biteRateList, filePath+runName+"_bite_rate.csv");
+    if (ctx.params.dyn_intragenic_recombination_p)
+        series.push_back(Series{"intragenic_recombination_p", &intragenicRecombinationPList, nullptr});
 
-    if (ParamManager::dyn_intragenic_recombination_p)
-        utilities::arrayToFile(intragenicRecombinationPList, filePath+runName+"_intragenic_recombination_p.csv");
+    return series;
+}
+
+//Header text stored in binary output: the run's calling arguments, if main has written them.
+std::string Output::run_header(const std::string runName, const std::string filePath) const
+{
+    std::ifstream file(filePath+runName+"_calling_arguments.txt");
+    std::stringstream header;
+    header << file.rdbuf();
+    return header.str();
+}
+
+//Writes every series (and the antigen frequency matrix, one row per output time) to a single columnar file, runName.tdmc.
+void Output::export_binary_output(const std::string runName, const std::string filePath)
+{
+    columnar::Writer writer;
+    writer.open(filePath+runName+".tdmc", run_header(runName, filePath));
+
+    const std::vector<Series> series = get_series();
+    for (const Series& s : series)
+        writer.add_column(s.name, s.floats != nullptr ? columnar::Type::FLOAT32 : columnar::Type::UINT32);
+    if (dense_antigen_frequency())
+        writer.add_column("circulating_antigen_frequency", columnar::Type::UINT32, ctx.params.num_phenotypes);
+
+    for (unsigned int c=0; c<series.size(); ++c)
+    {
+        if (series[c].floats != nullptr)
+            writer.append(c, *series[c].floats);
+        else
+            writer.append(c, *series[c].uints);
+    }
+    if (dense_antigen_frequency())
+        writer.append(series.size(), antigen_frequency_matrix());
+
+    writer.close();
+}
+
+//Writes each series to runName_<name>.npy, or (zip) all of them to runName.npz. The antigen frequency matrix is a dense
+//uint32 array of shape (output times, num_phenotypes), i.e. the transpose of the CSV file.
+void Output::export_npy_output(const std::string runName, const std::string filePath, const bool zip)
+{
+    npy::ZipWriter npz;
+    if (zip)
+        npz.open(filePath+runName+".npz");
+
+    for (const Series& series : get_series())
+    {
+        if (zip && series.floats != nullptr)
+            npz.add(series.name, *series.floats);
+        else if (zip)
+            npz.add(series.name, *series.uints);
+        else if (series.floats != nullptr)
+            npy::save(filePath+runName+"_"+series.name+".npy", *series.floats);
+        else
+            npy::save(filePath+runName+"_"+series.name+".npy", *series.uints);
+    }
+
+    if (dense_antigen_frequency()) {
+        const std::vector<uint64_t> shape = {antigenFrequency.num_rows(), antigenFrequency.get_width()};
+        if (zip)
+            npz.add("circulating_antigen_frequency", antigen_frequency_matrix(), shape);
+        else
+            npy::save(filePath+runName+"_circulating_antigen_frequency.npy", antigen_frequency_matrix(), shape);
+    }
+
+    if (zip)
+        npz.close();
+}
+
+//Creates the same files as export_output and starts the writer thread. In CSV format the antigen frequency matrix is written one row
+//per output time (i.e. transposed) to "_circulating_antigen_frequency_stream.csv", as columns can't be appended to a text file.
+void Output::open_stream(const std::string runName, const std::string filePath)
+{
+    stream.reset(new StreamWriter());
+    if (ctx.params.output_format == "binary")
+        stream->use_columnar_file(filePath+runName+".tdmc", run_header(runName, filePath));
+
+    for (const Series& series : get_series())
+        stream->add_series(series.name, filePath+runName+"_"+series.name+".csv", series.uints != nullptr);
+
+    if (dense_antigen_frequency())
+        stream->set_matrix("circulating_antigen_frequency", filePath+runName+"_circulating_antigen_frequency_stream.csv", ", ", ctx.params.num_phenotypes);
+
+    stream->start();
+}
+
+//Hands the output that was just appended to the writer thread and clears it from memory.
+void Output::stream_latest_output()
+{
+    StreamRecord record;
+    for (const Series& series : get_series())
+        record.values.push_back(series.floats != nullptr ? series.floats->back() : series.uints->back());
+
+    if (dense_antigen_frequency())
+        record.matrixRow = antigenFrequency.get_latest();
+
+    stream->push(std::move(record));
+
+    timeLog.clear();
+    hPrevalence.clear();
+    mPrevalence.clear();
+    moi.clear();
+    eir.clear();
+    proportionCirculatingAntigens.clear();
+    shannonEntropy.clear();
+    simpsonDiversity.clear();
+    chao1Richness.clear();
+    absoluteImmunity.clear();
+    antigenGenerationRate.clear();
+    antigenLossRate.clear();
+    hostSusceptibility.clear();
+    topAntigensBound.clear();
+    for (unsigned int q=0; q<NUM_QUANTILES; ++q)
+    {
+        infectionDurationQuantiles[q].clear();
+        hostAgeAtInfectionQuantiles[q].clear();
+        hostImmunityQuantiles[q].clear();
+    }
+    numMosquitoesList.clear();
+    biteRateList.clear();
+    intragenicRecombinationPList.clear();
+    antigenFrequency.drop_rows();
 }
 
 void Output::register_infectious_bite()
@@ -108,6 +377,87 @@ void Output::register_infectious_bite()
     ++curNumInfectiousBites;
 }
 
+void Output::save(checkpoint::Writer& out)
+{
+    out.section("OUTP");
+    out.write(lastUpdateTime);
+    out.write(curNumInfectiousBites);
+    out.write(cumulativeOutputCount);
+
+    const std::vector<Series> series = get_series();
+    out.write<uint64_t>(series.size());
+    for (const Series& s : series)
+    {
+        out.write_string(s.name);
+        if (s.floats != nullptr)
+            out.write_vector(*s.floats);
+        else
+            out.write_vector(*s.uints);
+    }
+
+    antigenFrequency.save(out);
+    out.write<uint64_t>(hostImmunitySketches.size());
+    for (const ThreadSketch& sketch : hostImmunitySketches)
+        sketch.sketch.save(out);
+    out.write(checkpoint::file_length(antigenFrequencyChangesFile));
+    out.write(checkpoint::file_length(topAntigensFile));
+}
+
+void Output::load(checkpoint::Reader& in)
+{
+    in.section("OUTP");
+    in.read(lastUpdateTime);
+    in.read(curNumInfectiousBites);
+    in.read(cumulativeOutputCount);
+
+    //The series are members, so casting away get_series()'s const is safe.
+    const std::vector<Series> series = get_series();
+    in.expect<uint64_t>(series.size(), "number of output series");
+    for (const Series& s : series)
+    {
+        const std::string name = in.read_string();
+        if (name != s.name)
+            throw std::runtime_error("Output::load: the checkpoint has series '" + name + "' where '" + s.name + "' was expected (were different output options used?).");
+        if (s.floats != nullptr)
+            in.read_vector(*const_cast<std::vector<float>*>(s.floats));
+        else
+            in.read_vector(*const_cast<std::vector<unsigned int>*>(s.uints));
+    }
+
+    antigenFrequency.load(in);
+    hostImmunitySketches.resize(in.read<uint64_t>());
+    for (ThreadSketch& sketch : hostImmunitySketches)
+        sketch.sketch.load(in);
+
+    const uint64_t antigenFrequencyChangesLength = in.read<uint64_t>();
+    const uint64_t topAntigensLength = in.read<uint64_t>();
+    if (ctx.params.output_antigen_frequency && ctx.params.sparse_antigen_frequency)
+        checkpoint::reopen(antigenFrequencyChangesFile, ctx.params.file_path()+ctx.params.run_name()+"_circulating_antigen_frequency_changes.csv", antigenFrequencyChangesLength);
+    if (ctx.params.output_top_antigens > 0)
+        checkpoint::reopen(topAntigensFile, ctx.params.file_path()+ctx.params.run_name()+"_top_antigens.csv", topAntigensLength);
+}
+
+void Output::branch(const std::string& burnInPrefix)
+{
+    numMosquitoesList.resize(timeLog.size(), model->get_mos_manager()->get_count());
+    biteRateList.resize(timeLog.size(), ctx.params.bite_rate);
+    intragenicRecombinationPList.resize(timeLog.size(), ctx.params.intragenic_recombination_p);
+
+    const std::string prefix = ctx.params.file_path()+ctx.params.run_name();
+    if (ctx.params.output_antigen_frequency && ctx.params.sparse_antigen_frequency)
+        branching::continue_file(antigenFrequencyChangesFile, burnInPrefix+"_circulating_antigen_frequency_changes.csv", prefix+"_circulating_antigen_frequency_changes.csv");
+    if (ctx.params.output_top_antigens > 0)
+        branching::continue_file(topAntigensFile, burnInPrefix+"_top_antigens.csv", prefix+"_top_antigens.csv");
+}
+
+uint64_t Output::memory_bytes() const
+{
+    uint64_t bytes = antigenFrequency.memory_bytes() + memory::vector_bytes(topAntigens);
+    for (const Series& s : get_series())
+        bytes += s.floats != nullptr ? memory::vector_bytes(*s.floats) : memory::vector_bytes(*s.uints);
+    return bytes;
+}
+
 //responsible for: host prevalence, host immunity, moi
 void Output::calc_host_dependent_metrics(const Hosts& hosts)
 {
@@ -116,35 +466,71 @@ void Output::calc_host_dependent_metrics(const Hosts& hosts)
     float multiplicityOfInfection = 0.0f;
     float absImmunity = 0.0f;
 
-    #pragma omp parallel for reduction(+:prevalence, multiplicityOfInfection, absImmunity)
+    reset_partial_sums();
+    const unsigned int numPhenotypes = hosts.get_num_phenotypes();
+    QuantileSketch* immunitySketch = ctx.params.output_distributions ? &hostImmunitySketches[utilities::thread_num()].sketch : nullptr;
+    #pragma omp for schedule(static) nowait
     for (unsigned int i=0; i<hosts.size(); ++i)
     {
-        if (hosts[i].is_infected())
-        {
-            //Update counts for prevalence and moi
-            ++prevalence;
-            multiplicityOfInfection += hosts[i].infection1.infected;
-            multiplicityOfInfection += hosts[i].infection2.infected;
-        }
+        //Update counts for prevalence and moi (infection flag columns only)
+        prevalence += hosts.is_infected(i);
+        for (unsigned int s=0; s<Hosts::NUM_INFECTION_SLOTS; ++s)
+            multiplicityOfInfection += hosts.is_infected(i, s);
 
         //Calculate absolute immunity
+        const float* immuneState = hosts.get_immune_state(i);
         float curTotalImmunity = 0;
-        for (const float immunity : hosts[i].immuneState) //Sum immunity
-            curTotalImmunity += immunity;
-        curTotalImmunity = curTotalImmunity / hosts[i].immuneState.size(); // Total immunity
+        for (unsigned int a=0; a<numPhenotypes; ++a) //Sum immunity
+            curTotalImmunity += immuneState[a];
+        curTotalImmunity = curTotalImmunity / numPhenotypes; // Total immunity
+        if (immunitySketch != nullptr)
+            immunitySketch->update(curTotalImmunity);
         absImmunity += curTotalImmunity;
     }
+    add_partial_sum(0, prevalence);
+    add_partial_sum(1, multiplicityOfInfection);
+    add_partial_sum(2, absImmunity);
+    #pragma omp barrier
+
+    #pragma omp single
+    {
+        prevalence = partialSums[0] / (float) ctx.params.num_hosts;
+        multiplicityOfInfection = partialSums[1] / (float) ctx.params.num_hosts;
+        absImmunity = partialSums[2] / (float) ctx.params.num_hosts;
+
+        hPrevalence.push_back(prevalence);
+
+        moi.push_back(multiplicityOfInfection);
+        absoluteImmunity.push_back(absImmunity);
+
+        std::cout << "Host prevalence: " << prevalence << "\tabsImmunity: " << absImmunity << std::endl;
+    }
+}
 
-    prevalence = prevalence / (float) ParamManager::num_hosts;
-    multiplicityOfInfection = multiplicityOfInfection / (float) ParamManager::num_hosts;
-    absImmunity = absImmunity / (float) ParamManager::num_hosts;
+//Percentiles of infection duration and host age at infection (over the interval) and host immunity. Merges every thread's sketches.
+void Output::calc_distribution_metrics()
+{
+    if (!ctx.params.output_distributions)
+        return;
 
-    hPrevalence.push_back(prevalence);
+    QuantileSketch durations, ages, immunity;
+    ctx.distributions.collect(durations, ages);
+    for (ThreadSketch& sketch : hostImmunitySketches)
+    {
+        immunity.merge(sketch.sketch);
+        sketch.sketch.clear();
+    }
 
-    moi.push_back(multiplicityOfInfection);
-    absoluteImmunity.push_back(absImmunity);
+    append_quantiles(infectionDurationQuantiles, durations);
+    append_quantiles(hostAgeAtInfectionQuantiles, ages);
+    append_quantiles(hostImmunityQuantiles, immunity);
+}
 
-    std::cout << "Host prevalence: " << prevalence << "\tabsImmunity: " << absImmunity << std::endl;
+void Output::append_quantiles(QuantileSeries& series, const QuantileSketch& sketch)
+{
+    const std::vector<float> values = sketch.quantiles(QUANTILES);
+    for (unsigned int q=0; q<NUM_QUANTILES; ++q)
+        series[q].push_back(values[q]);
 }
 
 //mosquito prevalence
@@ -153,15 +539,18 @@ void Output::calc_mosquito_dependent_metrics(const Mosquitoes& mosquitoes)
     float prevalence=0.0f; //Mosquito prevalence
 
     //Loop through mosquitoes
-    #pragma omp parallel for reduction(+:prevalence)
-    for (unsigned int i=0; i<mosquitoes.size(); ++i)
+    reset_partial_sums();
+    #pragma omp for schedule(static) nowait
+    for (unsigned int b=0; b<mosquitoes.num_blocks(); ++b)
     {
         //Count number of mosquitoes that are infected
-        if (mosquitoes[i].is_active())
-            prevalence += mosquitoes[i].is_infected();
+        prevalence += mosquitoes.count_infected_block(b);
     }
-    prevalence = prevalence / model->get_mos_manager()->get_count();
-    mPrevalence.push_back(prevalence);
+    add_partial_sum(0, prevalence);
+    #pragma omp barrier
+
+    #pragma omp single
+    mPrevalence.push_back(partialSums[0] / model->get_mos_manager()->get_count());
 }
 
 
@@ -173,15 +562,15 @@ void Output::calc_time_dependent_metrics(const unsigned int currentTime)
     //Calculate eir
     //Tracks time since last update because output interval can change over the course of a simulation.
     unsigned int timeSinceLastUpdate = currentTime - lastUpdateTime;
-    float curEir = (float)curNumInfectiousBites / (float)ParamManager::num_hosts;
+    float curEir = (float)curNumInfectiousBites / (float)ctx.params.num_hosts;
     curEir = curEir / (float)timeSinceLastUpdate;
     //Reset infectious bite counteer
     curNumInfectiousBites = 0;
     eir.push_back(curEir);
 
     //Calculate rate of new antigen generation and loss
-    antigenGenerationRate.push_back(((float)DiversityMonitor::get_current_generation_count()) / (float)timeSinceLastUpdate);
-    antigenLossRate.push_back(((float)DiversityMonitor::get_current_loss_count()) / (float)timeSinceLastUpdate);
+    antigenGenerationRate.push_back(((float)ctx.diversity.get_current_generation_count()) / (float)timeSinceLastUpdate);
+    antigenLossRate.push_back(((float)ctx.diversity.get_current_loss_count()) / (float)timeSinceLastUpdate);
 
     //std::cout << "\ngen: " << antigenGenerationRate.back() << "\n";
     //std::cout << "loss: " << antigenLossRate.back() << "\n";
@@ -190,138 +579,109 @@ void Output::calc_time_dependent_metrics(const unsigned int currentTime)
 //Track any dynamic (time dependent) parameters over time.
 void Output::calc_dyn_metrics()
 {
-    if (ParamManager::dyn_num_mosquitoes)
+    if (ctx.params.dyn_num_mosquitoes)
         numMosquitoesList.push_back(model->get_mos_manager()->get_count());
 
-    if (ParamManager::dyn_bite_rate)
-        biteRateList.push_back(ParamManager::bite_rate);
+    if (ctx.params.dyn_bite_rate)
+        biteRateList.push_back(ctx.params.bite_rate);
 
-    if (ParamManager::dyn_intragenic_recombination_p)
-        intragenicRecombinationPList.push_back(ParamManager::intragenic_recombination_p);
+    if (ctx.params.dyn_intragenic_recombination_p)
+        intragenicRecombinationPList.push_back(ctx.params.intragenic_recombination_p);
 }
 
 
-//numCirculatingAntigens, shannon entropy, antigen frequency, parasite adaptedness
+//numCirculatingAntigens, shannon entropy, simpson diversity, chao1 richness, antigen frequency, parasite adaptedness
 //Optional: antigen frequency, parasite adaptedness
 void Output::calc_host_mosquito_dependent_metrics(const Hosts& hosts, const Mosquitoes& mosquitoes)
 {
     //Use frequency to calculate some outputs
     //std::cout << uniqueAntigenCount << ", " << ((float)uniqueAntigenCount) / ((float)ParamManager::instance().get_int("num_phenotypes")) << "\n";
-    proportionCirculatingAntigens.push_back(((float)DiversityMonitor::get_num_unique_antigens()) / ((float)ParamManager::num_phenotypes));
-    shannonEntropy.push_back(Output::calc_shannon_entropy(DiversityMonitor::get_antigen_counts(), DiversityMonitor::get_total_antigens()));
-
-    //Calculate antigen proportions by normalising by total
-    if (ParamManager::output_antigen_frequency) //Turns out we need to do this for shannon entropy anyway!
-        antigenFrequency.push_back(DiversityMonitor::get_antigen_counts());
-
     //No need to calculate antigen proportions from antigen frequencies?
-    if (ParamManager::output_host_susceptibility)
+    float susceptibility = 0.0f;
+    if (ctx.params.output_host_susceptibility)
+        susceptibility = calc_host_susceptibility(ctx.diversity.get_antigen_counts(), ctx.diversity.get_total_antigens(), hosts);
+
+    #pragma omp single
     {
-        hostSusceptibility.push_back(calc_host_susceptibility(DiversityMonitor::get_antigen_counts(), DiversityMonitor::get_total_antigens(), hosts));
+        proportionCirculatingAntigens.push_back(((float)ctx.diversity.get_num_unique_antigens()) / ((float)ctx.params.num_phenotypes));
+        shannonEntropy.push_back(ctx.diversity.get_shannon_entropy()); //Maintained incrementally by DiversityMonitor, as are the others.
+        simpsonDiversity.push_back(ctx.diversity.get_simpson_diversity());
+        chao1Richness.push_back(ctx.diversity.get_chao1_richness());
+
+        //Calculate antigen proportions by normalising by total
+        if (ctx.params.output_antigen_frequency) {
+            antigenFrequency.append(ctx.diversity.get_antigen_counts());
+
+            if (antigenFrequencyChangesFile.is_open()) {
+                const uint64_t outputIndex = cumulativeOutputCount;
+                antigenFrequency.for_each_change(antigenFrequency.num_rows()-1, [&](const uint32_t antigen, const uint32_t count) {
+                    antigenFrequencyChangesFile << outputIndex << ", " << antigen << ", " << count << "\n";
+                });
+                antigenFrequency.drop_rows();
+            }
+        }
+
+        if (ctx.params.output_host_susceptibility)
+            hostSusceptibility.push_back(susceptibility);
+
+        if (ctx.params.output_top_antigens > 0) {
+            topAntigensBound.push_back(ctx.diversity.get_top_antigens(topAntigens));
+            for (const TopAntigenTracker::Entry& entry : topAntigens)
+                topAntigensFile << cumulativeOutputCount << ", " << entry.first << ", " << entry.second << "\n";
+        }
     }
 
     //unsigned int uniqueCount;
     //unsigned int totalCount;
     //testing::long_diversity_count(uniqueCount, totalCount, hosts, mosquitoes);
     //std::cout << "Long method: " << uniqueCount << "\t" << totalCount << "\n";
-    //std::cout << "Quik method: " << DiversityMonitor::get_num_unique_antigens() << "\t" << DiversityMonitor::get_total_antigens() << "\n";
+    //std::cout << "Quik method: " << ctx.diversity.get_num_unique_antigens() << "\t" << ctx.diversity.get_total_antigens() << "\n";
 }
 
 
 
 
 
-float Output::calc_shannon_entropy(const std::vector<unsigned int>& curAntigenFrequency, const unsigned int totalAntigens)//const std::unordered_map<Antigen, const unsigned int>& curAntigenFrequency)
-{
-    if (totalAntigens == 0)
-        return 0.0;
-
-    float entropy = 0.0;
-    #pragma omp parallel for reduction(+:entropy)
-    for (unsigned int i=0; i<curAntigenFrequency.size(); ++i)
-    {
-        float proportion = (float)curAntigenFrequency[i]/(float)totalAntigens;
-        if (proportion != 0)
-            entropy -= proportion * std::log(proportion);
-    }
-    //std::cout << "Entropy = " << entropy << "\n";
-
-    return entropy;
-}
-
 //Measure of how susceptible the host population is (ranges between 0 and 1). I.e. take away from 1 to give host adaptedness.
+//Returns the team total to every thread.
 float Output::calc_host_susceptibility(const std::vector<unsigned int>& curAntigenFrequencies, const unsigned int antigenTotal, const Hosts& hosts)
 {
     if (antigenTotal == 0)
         return 0;
 
-    //Calculate immunity to each antigen
-    std::vector<float> immunity(ParamManager::num_phenotypes, 0.0f);
-
-    #pragma omp parallel for
-    for (unsigned int a=0; a<ParamManager::num_phenotypes; ++a)
+    //Mean (lack of) immunity to each antigen, weighted by that antigen's frequency:
+    //  sum_a w_a * (1 - mean_h immunity[h][a])  =  (1/numHosts) * sum_h sum_a w_a * (1 - immunity[h][a])
+    //The second form walks each host's immune state row contiguously rather than striding down a column per antigen. The sums are
+    //kept in double: there are num_hosts * num_phenotypes terms.
+    const unsigned int numPhenotypes = hosts.get_num_phenotypes();
+    double weightedSusceptibility = 0.0;
+    reset_partial_sums();
+    #pragma omp for schedule(static) nowait
+    for (unsigned int h=0; h<hosts.size(); ++h)
     {
-        for (unsigned int h=0; h<hosts.size(); ++h)
-            immunity[a] += 1.0 - hosts[h].immuneState[a];
-        immunity[a] = immunity[a] / (float)hosts.size();
-        //if (immunity[a] > 1.0)
-        //    std::cout << "WARNING: immunity[a] = " << immunity[a] << "\n";
+        const float* immuneState = hosts.get_immune_state(h);
+        double hostSusceptibility = 0.0;
+        for (unsigned int a=0; a<numPhenotypes; ++a)
+            hostSusceptibility += (double)curAntigenFrequencies[a] * (1.0 - immuneState[a]);
+        weightedSusceptibility += hostSusceptibility;
     }
+    add_partial_sum(0, weightedSusceptibility);
+    #pragma omp barrier
 
-
-    //Calculate host susceptibility
-    float hostSusceptibility = 0.0f;
-    #pragma omp parallel for reduction (+:hostSusceptibility)
-    for (unsigned int a=0; a<ParamManager::num_phenotypes; ++a) {
-        //if (((float)curAntigenFrequencies[a] / (float) antigenTotal) > 1.0)
-        //    std::cout << "WARNING: p(a) = " << ((float)curAntigenFrequencies[a] / (float) antigenTotal) << "\n";
-        hostSusceptibility += ((float)curAntigenFrequencies[a] / (float) antigenTotal) * immunity[a];
-    }
+    float hostSusceptibility = (float)(partialSums[0] / ((double)hosts.size() * antigenTotal));
 
     //std::cout << "Host susceptibility = " << hostSusceptibility << "\n";
+    #pragma omp barrier //Everyone has read the total before partialSums is reused.
     return hostSusceptibility;
 }
 
 
-//Counts and outputs the frequency of strain repertoires.
-//TODO: optimise with omp. http://stackoverflow.com/questions/15855609/openmpc-c-efficient-way-of-sharing-an-unordered-mapstring-vectorint-an for hints on sharing the unordered_map
+//Counts and outputs the frequency of strain repertoires (to _strain_structure.tdmc). Must be called by every thread, see StrainCensus::count.
 void Output::process_strain_structure_output(const Hosts& hosts, const Mosquitoes& mosquitoes)
 {
-    if (ParamManager::output_strain_structure == false)
+    if (ctx.params.output_strain_structure == false)
         return;
 
-    std::unordered_map<std::string, unsigned int> strainFrequencies;
-
-    //Need to count strains in host and mosquito infections
-    for (unsigned int iH=0; iH<hosts.size(); ++iH)
-    {
-        if (hosts[iH].infection1.infected)
-            strainFrequencies[strain_phenotype_str_ordered(hosts[iH].infection1.strain)] += 1;
-
-        if (hosts[iH].infection2.infected)
-            strainFrequencies[strain_phenotype_str_ordered(hosts[iH].infection2.strain)] += 1;
-    }
-
-    for (unsigned int iM=0; iM<mosquitoes.size(); ++iM)
-    {
-        if (mosquitoes[iM].is_active() && mosquitoes[iM].infection.infected)
-            strainFrequencies[strain_phenotype_str_ordered(mosquitoes[iM].infection.strain)] += 1;
-    }
-
-    //Output to file
-    int status = mkdir("strain_structure", 0755); //https://linux.die.net/man/2/mkdir
-
-    //create file name
-    std::ostringstream outputFilename;
-    outputFilename << ParamManager::file_path() << "strain_structure/" << ParamManager::run_name() << "_strain_structure" << cumulativeOutputCount << ".csv";
-
-
-    std::ofstream file;
-    file.open(outputFilename.str(), std::ofstream::out | std::ofstream::trunc);
-    for (auto entry : strainFrequencies)
-        file << entry.first << ", " << entry.second << "\n";
-
-    file.flush();
-    file.close();
+    strainCensus.count(hosts, mosquitoes);
 }
 
@@ -1,15 +1,27 @@
 #pragma once
-#include "host.hpp"
-#include "mosquito.hpp"
+#include "host_population.hpp"
+#include "mosquito_population.hpp"
+#include "quantile_sketch.hpp"
+#include "sparse_history.hpp"
+#include "strain_census.hpp"
+#include "top_antigen_tracker.hpp"
+#include "stream_writer.hpp"
+#include <array>
+#include <fstream>
+#include <memory>
 
+class EnsembleSummary;
 class ModelDriver;
+class ModelContext;
+namespace checkpoint { class Writer; class Reader; }
 
 class Output
 {
 private:
-    typedef std::vector<Host> Hosts;
-    typedef std::vector<Mosquito> Mosquitoes;
+    typedef HostPopulation Hosts;
+    typedef MosquitoPopulation Mosquitoes;
 
+    ModelContext& ctx;
     ModelDriver* model;
 
     //Counters
@@ -24,6 +36,8 @@ private:
     std::vector<float> eir; //EIR (daily)
     std::vector<float> proportionCirculatingAntigens; //Proportion of antigen space represented by the antigens in circulation.
     std::vector<float> shannonEntropy; //shannon entropy of antigens in circulation
+    std::vector<float> simpsonDiversity; //Gini-Simpson index of antigens in circulation
+    std::vector<float> chao1Richness; //Chao1 estimate of antigen richness (observed antigens plus an estimate of unobserved ones)
     std::vector<float> absoluteImmunity; //Total number of antigens to which
     std::vector<float> antigenGenerationRate; //Rate of new antigen generation (per day)
     std::vector<float> antigenLossRate; //Rate of antigen loss (per day)
@@ -31,38 +45,98 @@ private:
     //Optional output
     std::vector<float> hostSusceptibility; //Outputs a number (ranging between 0 and 1) indicating the mean susceptibility of the host popualtion to currently circulating parasite population.
     //std::vector<float> parasiteAdaptedness; //Measure of how adapted the parasite population is to the current host immunity
-    std::vector<std::vector<unsigned int>> antigenFrequency; //frequency of each antigen type, at each output time interval
+    SparseHistory antigenFrequency; //frequency of each antigen type, at each output time interval (stored as changes between outputs)
+    std::ofstream antigenFrequencyChangesFile; //sparse_antigen_frequency only: changes are appended at each output rather than stored.
+    bool dense_antigen_frequency() const; //Whether the full antigen frequency matrix is output.
+    void write_antigen_frequency_csv(const std::string& filename) const;
+    std::vector<unsigned int> antigen_frequency_matrix() const; //Row major, (output times, num_phenotypes)
+
+    std::vector<unsigned int> topAntigensBound; //Largest count of any antigen not in that output's top antigens (output_top_antigens)
+    std::ofstream topAntigensFile; //output_top_antigens: the top antigens are appended at each output.
+    std::vector<TopAntigenTracker::Entry> topAntigens; //Scratch
+
+    //Distributions (output_distributions): one series per percentile in QUANTILES.
+    static const unsigned int NUM_QUANTILES = 5;
+    typedef std::array<std::vector<float>, NUM_QUANTILES> QuantileSeries;
+    QuantileSeries infectionDurationQuantiles; //Infections started during the interval
+    QuantileSeries hostAgeAtInfectionQuantiles; //Infections started during the interval
+    QuantileSeries hostImmunityQuantiles; //Per host total immunity, as in absoluteImmunity
+    struct ThreadSketch
+    {
+        QuantileSketch sketch;
+        char padding[64]; //Keeps adjacent threads' sketches on separate cache lines.
+    };
+    std::vector<ThreadSketch> hostImmunitySketches; //Per thread
 
     //Dynamic parameters
     std::vector<unsigned int> numMosquitoesList; //Tracks number of mosquitoes over time
     std::vector<float> biteRateList; //Tracks bite rate over time
     std::vector<float> intragenicRecombinationPList; //Tracks intragenic recombination rate over time
 
+    std::string run_header(const std::string runName, const std::string filePath) const;
+    void export_binary_output(const std::string runName, const std::string filePath);
+    void export_npy_output(const std::string runName, const std::string filePath, const bool zip);
+
+    EnsembleSummary* ensemble = nullptr; //Given every output as it is appended (ensemble_size), see ensemble.hpp.
+
+    //Streamed output (stream_output): each output is handed to a background writer and then dropped from the vectors above.
+    std::unique_ptr<StreamWriter> stream;
+    void open_stream(const std::string runName, const std::string filePath);
+    void stream_latest_output();
+
+    //Shared scratch space for combining each thread's partial sums when metrics are calculated from inside a parallel region.
+    std::array<double, 3> partialSums;
+    void reset_partial_sums();
+    void add_partial_sum(const unsigned int i, const double value);
+
     void calc_host_dependent_metrics(const Hosts& hosts); //host prevalence, host immunity, moi
     void calc_mosquito_dependent_metrics(const Mosquitoes& mosquitoes); //mosquito prevalence
     void calc_host_mosquito_dependent_metrics(const Hosts& hosts, const Mosquitoes& mosquitoes); //antigen diversity, shannon entropy, antigen frequency, parasite adaptedness
     void calc_time_dependent_metrics(const unsigned int currentTime); //time, daily EIR
     void calc_dyn_metrics();
+    void calc_distribution_metrics();
+    void append_quantiles(QuantileSeries& series, const QuantileSketch& sketch);
 
     //Calculates and outputs repertoire frequencies
+    StrainCensus strainCensus;
     void process_strain_structure_output(const Hosts& hosts, const Mosquitoes& mosquitoes);
 
     void count_individual_antigens(std::vector<unsigned int>& antigenFreqs, unsigned int& antigenCounter, const Strain& strain);
     float calc_host_susceptibility(const std::vector<unsigned int>& curAntigenFrequencies, const unsigned int totalAntigens, const Hosts& hosts);
     float calc_parasite_adaptedness(const std::vector<unsigned int>& curAntigenFrequencies, const unsigned int antigenTotal, const Hosts& hosts);
-    static float calc_shannon_entropy(const std::vector<unsigned int>& curAntigenFrequency, const unsigned int totalAntigens);
     //float calc_shannon_entropy(const std::unordered_map<Antigen, unsigned int>& diversityPool);
     //float calc_shannon_entropy(const std::vector<unsigned int>& curAntigenFrequency);
     //void antigen_counter_helper(std::vector<unsigned int>& antigenFreqs, const Strain& strain);
     void log_dyn_params();
 
 public:
+    //A time series, for writing every series the same way. Exactly one of floats / uints is set.
+    struct Series
+    {
+        std::string name;
+        const std::vector<float>* floats;
+        const std::vector<unsigned int>* uints;
+    };
+    std::vector<Series> get_series() const; //With stream_output, only the latest value of each series is held.
 
-    Output(ModelDriver* _model) : model(_model) {  }
+    Output(ModelContext& _ctx, ModelDriver* _model);
     void preinitialise_output_storage();
     void append_output(const unsigned int timestep, const Hosts& hosts, const Mosquitoes& mosquitoes);
-    void export_output(const std::string runName=ParamManager::run_name(), const std::string filePath=ParamManager::file_path());
+    void export_output(); //Uses the run name and file path parameters.
+    void export_output(const std::string runName, const std::string filePath);
+    void set_ensemble(EnsembleSummary* _ensemble) { ensemble = _ensemble; }
     void register_infectious_bite();
+
+    //Checkpointing. Output written as the run goes (stream_output, output_strain_structure) can't be checkpointed.
+    void save(checkpoint::Writer& out);
+    void load(checkpoint::Reader& in); //In place of preinitialise_output_storage().
+
+    //Carries the burn-in's output (files burnInPrefix*) on under a scenario's run name, see branching.hpp. Call before the scenario's
+    //settings are applied: dynamic parameter series its adaptors start are filled in with the burn-in's (constant) values.
+    void branch(const std::string& burnInPrefix);
+
+    uint64_t memory_bytes() const; //History series, antigen frequencies and other per output buffers.
+    uint64_t strain_structure_memory_bytes() const { return strainCensus.memory_bytes(); }
 };
 
 
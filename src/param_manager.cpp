@@ -1,64 +1,13 @@
 #include "param_manager.hpp"
-#include "mosquito.hpp"
 #include "utilities.hpp"
 #include "adaptors/output_interval_adaptor.hpp"
-#include "diversity_monitor.hpp"
+#include "checkpoint.hpp"
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <stdexcept>
 
 #include <iostream>
-#include <omp.h>
-
-std::string ParamManager::runName = "default";
-std::string ParamManager::filePath = "";
-
-bool ParamManager::verbose = false;
-bool ParamManager::unique_initial_strains = false;
-
-unsigned int ParamManager::run_time = 10000;//50000;
-unsigned int ParamManager::output_interval = 250;//250;
-unsigned int ParamManager::burn_in_period = 3000;//3000;
-unsigned int ParamManager::num_hosts = 8000;
-unsigned int ParamManager::initial_num_mosquitoes = 8000;
-unsigned int ParamManager::initial_antigen_diversity = 2500;
-unsigned int ParamManager::initial_num_strains = 40;
-unsigned int ParamManager::initial_num_mosquito_infections = 500;
-unsigned int ParamManager::num_phenotypes = 50000;
-unsigned int ParamManager::num_genotype_only_bits = 7;
-unsigned int ParamManager::genotypic_space_size = std::numeric_limits<unsigned int>::max();
-unsigned int ParamManager::repertoire_size = 60;
-unsigned int ParamManager::mean_mosquito_life_expectancy = 32; //In days, Bellan2010.
-unsigned int ParamManager::mosquito_eip = 10; //Extrinsic inoculation period in days, Deitz1974.
-unsigned int ParamManager::reintroduction_interval = 0;
-
-float ParamManager::bite_rate = 0.12f;
-float ParamManager::intergenic_recombination_p = 0.01f;
-float ParamManager::intragenic_recombination_p = 0.002f;
-float ParamManager::recombination_scale = 50.0f;
-float ParamManager::infection_duration_scale = 2.0f;
-float ParamManager::infectivity_scale = 0.5f;
-float ParamManager::cross_immunity = 0.0f;
-float ParamManager::immunityScale = 1.0f;
-
-////Output management
-bool ParamManager::output_antigen_frequency = false; //Outputs the frequency with which antigens are present in the parasite population.
-bool ParamManager::output_host_susceptibility = false; //Outputs a number (ranging between 0 and 1) indicating the mean susceptibility of the host popualtion to currently circulating parasite population.
-bool ParamManager::output_strain_structure = false; //Output a list of all strain vector frequencies each output interval (uses multiple files).
-
-////Dynamic support parameters.
-//Dynamic mosquito population (MosquitoPopulationAdaptor).
-bool ParamManager::dyn_num_mosquitoes = false; //Used to know whether or not to output timeseries of number of mosquitoes for example.
-unsigned int ParamManager::max_num_mosquitoes = initial_num_mosquitoes; //Used to reserve space in vectors.
-//Dynamic bite rate (BiteRateAdaptor).
-bool ParamManager::dyn_bite_rate = false;
-bool ParamManager::dyn_intragenic_recombination_p = false;
-
-std::list<float> ParamManager::immunityMask;
-BITE_FREQUENCY_TABLE ParamManager::cumulativeBiteFrequencyDistribution;
-unsigned int ParamManager::output_size_needed = 0;
-std::array<float, 2> ParamManager::recombination_cumu_p;
-std::list<Adaptor*> ParamManager::adaptors;
 
 bool ParamManager::recalculate_derived_parameters()
 {
@@ -68,15 +17,34 @@ bool ParamManager::recalculate_derived_parameters()
     //if (!next_function())
         //throw std::runtime_error("");
 
+    if (output_format != "csv" && output_format != "binary" && output_format != "npy" && output_format != "npz")
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: unknown output_format '" + output_format + "' (expected csv, binary, npy or npz).");
+    if (stream_output && (output_format == "npy" || output_format == "npz"))
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: stream_output only supports the csv and binary output formats.");
+    if (profile_counters && !output_profile)
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: profile_counters needs output_profile.");
+    if (audit_budget < 0.0f)
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: audit_budget must not be negative.");
+    if ((checkpoint_interval != 0 || !resume_from.empty()) && (stream_output || output_strain_structure))
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: checkpoints can't be used with stream_output or output_strain_structure.");
+    if (!scenario_file.empty() && (stream_output || output_strain_structure))
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: scenarios can't be branched with stream_output or output_strain_structure.");
+    if (ensemble_size > 1 && (checkpoint_interval != 0 || !resume_from.empty() || !scenario_file.empty()))
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: ensembles can't be checkpointed, resumed or branched into scenarios.");
+    if (trace_num_days != 0 && trace_buffer_events == 0)
+        throw std::runtime_error("ParamManager::recalculate_derived_parameters: trace_buffer_events must be > 0 when tracing (trace_num_days > 0).");
+
+    if (max_num_mosquitoes < initial_num_mosquitoes) //max_num_mosquitoes is the mosquito population's fixed capacity.
+        max_num_mosquitoes = initial_num_mosquitoes;
+
     recalculate_cumulative_bite_frequency_distribution();
     recalculate_output_array_size_needed();
     recalculate_immunity_mask();
+    recalculate_genotype_mask();
 
     //if (paramsBool["output_parasite_adaptedness"])
     //    paramsBool["output_antigen_frequency"] = true;
 
-    DiversityMonitor::reset();
-
     return true;
 }
 
@@ -88,7 +56,7 @@ bool ParamManager::recalculate_recombination_distributions()
 
 void ParamManager::recalculate_cumulative_bite_frequency_distribution()
 {
-    const float biteRate = ParamManager::bite_rate;
+    const float biteRate = bite_rate;
     BITE_FREQUENCY_TABLE pdfPoisson;
     for (unsigned int k=0; k<pdfPoisson.size(); k++)
         pdfPoisson[k] = ((float)std::pow(biteRate, k) * std::exp(-biteRate)) / (float) utilities::factorial(k);
@@ -107,7 +75,7 @@ void ParamManager::recalculate_immunity_mask()
 
     immunityMask.push_back(1.0); //peak.
 
-    if (ParamManager::cross_immunity == 0.0f) //If cross-immunity is turned off, just return the peak.
+    if (cross_immunity == 0.0f) //If cross-immunity is turned off, just return the peak.
         return;
     else
     {
@@ -115,7 +83,7 @@ void ParamManager::recalculate_immunity_mask()
         unsigned int x = 1;
         float curVal = 1.0;
         float mu = 0.0;
-        float var = ParamManager::cross_immunity; //Variance
+        float var = cross_immunity; //Variance
         float amp = 1.0;
 
         while (curVal >= 0.01) //Keep going until the distribution is very low.
@@ -137,6 +105,16 @@ void ParamManager::recalculate_immunity_mask()
     }
 }
 
+void ParamManager::recalculate_genotype_mask()
+{
+    genotype_mask = 0;
+    for (unsigned int i=0; i<num_genotype_only_bits; ++i)
+    {
+        genotype_mask = genotype_mask << 1;
+        genotype_mask+=1;
+    }
+}
+
 void ParamManager::recalculate_output_array_size_needed()
 {
     unsigned int sizeNeeded = (run_time / output_interval) + 1;
@@ -170,6 +148,8 @@ void ParamManager::set_param(const std::string name, const std::string value)
     else if (name == "unique_initial_strains")
         unique_initial_strains = (value == "true" || value == "1" || value == "True" || value == "TRUE");
 
+    else if (name == "random_seed")
+        random_seed = std::stoul(value);
     else if (name == "run_time")
         run_time = std::stoi(value);
     else if (name == "output_interval")
@@ -220,10 +200,50 @@ void ParamManager::set_param(const std::string name, const std::string value)
 
     else if (name == "output_antigen_frequency")
         output_antigen_frequency = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "sparse_antigen_frequency")
+        sparse_antigen_frequency = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "output_top_antigens")
+        output_top_antigens = std::stoi(value);
+    else if (name == "output_distributions")
+        output_distributions = (value == "true" || value == "1" || value == "True" || value == "TRUE");
     else if (name == "output_host_susceptibility")
         output_host_susceptibility = (value == "true" || value == "1" || value == "True" || value == "TRUE");
     else if (name == "output_strain_structure")
         output_strain_structure = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "output_format")
+        output_format = value;
+    else if (name == "stream_output")
+        stream_output = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "output_profile")
+        output_profile = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "profile_counters")
+        profile_counters = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "trace_first_day")
+        trace_first_day = std::stoi(value);
+    else if (name == "trace_num_days")
+        trace_num_days = std::stoi(value);
+    else if (name == "trace_buffer_events")
+        trace_buffer_events = std::stoi(value);
+    else if (name == "audit_interval")
+        audit_interval = std::stoi(value);
+    else if (name == "audit_self_heal")
+        audit_self_heal = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "audit_budget")
+        audit_budget = std::stof(value);
+    else if (name == "output_memory")
+        output_memory = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "dry_run")
+        dry_run = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+    else if (name == "checkpoint_interval")
+        checkpoint_interval = std::stoi(value);
+    else if (name == "resume_from")
+        resume_from = value;
+    else if (name == "scenario_file")
+        scenario_file = value;
+    else if (name == "max_concurrent_scenarios")
+        max_concurrent_scenarios = std::stoi(value);
+    else if (name == "ensemble_size")
+        ensemble_size = std::stoi(value);
 
     else if (name == "dyn_num_mosquitoes")
         dyn_num_mosquitoes = (value == "true" || value == "1" || value == "True" || value == "TRUE");
@@ -278,6 +298,40 @@ void ParamManager::update_adaptors(const unsigned int t)
         adaptor->update(t);
 }
 
+void ParamManager::save(checkpoint::Writer& out) const
+{
+    out.section("PARA");
+    out.write(bite_rate);
+    out.write(intragenic_recombination_p);
+    out.write(output_interval);
+    out.write<uint64_t>(adaptors.size());
+    for (const Adaptor* adaptor : adaptors)
+    {
+        out.write_string(adaptor->get_adaptor_name());
+        out.write(adaptor->get_start_t());
+        adaptor->save(out);
+    }
+}
+
+void ParamManager::load(checkpoint::Reader& in)
+{
+    in.section("PARA");
+    in.read(bite_rate);
+    in.read(intragenic_recombination_p);
+    in.read(output_interval);
+    in.expect<uint64_t>(adaptors.size(), "number of adaptors");
+    for (Adaptor* adaptor : adaptors)
+    {
+        const std::string name = in.read_string();
+        const unsigned int start = in.read<unsigned int>();
+        if (name != adaptor->get_adaptor_name() || start != adaptor->get_start_t())
+            throw std::runtime_error("ParamManager::load: the checkpoint has a " + name + " starting at t=" + std::to_string(start) + " where this run has a "
+                                     + adaptor->get_adaptor_name() + " starting at t=" + std::to_string(adaptor->get_start_t()) + ".");
+        adaptor->load(in);
+    }
+    recalculate_cumulative_bite_frequency_distribution();
+    recalculate_recombination_distributions();
+}
 
 ParamManager::~ParamManager()
 {
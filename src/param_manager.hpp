@@ -2,90 +2,120 @@
 #include "adaptors/adaptor.hpp"
 #include "global_typedefs.hpp"
 #include <array>
+#include <limits>
 #include <list>
 #include <string>
 #include <unordered_map>
 
 class Adaptor;
 
-//Based on http://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+//Parameters of a single model run, owned by that run's ModelContext. Adaptors added here are owned (and deleted) by the ParamManager.
 class ParamManager
 {
 private:
     //
 public:
-    static std::string runName;
-    static std::string filePath;
-
-    static bool verbose;
-    static bool unique_initial_strains;
-
-    static unsigned int run_time;
-    static unsigned int output_interval;
-    static unsigned int burn_in_period;
-    static unsigned int num_hosts;
-    static unsigned int initial_num_mosquitoes;
-    static unsigned int initial_antigen_diversity;
-    static unsigned int initial_num_strains;
-    static unsigned int initial_num_mosquito_infections;
-    static unsigned int num_phenotypes;
-    static unsigned int num_genotype_only_bits;
-    static unsigned int genotypic_space_size;
-    static unsigned int repertoire_size;
-    static unsigned int mean_mosquito_life_expectancy; //In days, Bellan2010.
-    static unsigned int mosquito_eip; //Extrinsic inoculation period in days, Deitz1974.
-    static unsigned int reintroduction_interval; //How often is a random extinct initial strain reintroduced? 0 = never. NOTE: only works when intra and inter recombination rate are 0.0, AND unique_initial_strains = 0.
-
-    static float bite_rate;
-    static float intergenic_recombination_p;
-    static float intragenic_recombination_p;
-    static float recombination_scale;
-    static float infection_duration_scale;
-    static float infectivity_scale;
-    static float cross_immunity;
-    static float immunityScale; //Linear scaling of immunity.
+    std::string runName = "default";
+    std::string filePath = "";
+
+    bool verbose = false;
+    bool unique_initial_strains = false;
+
+    unsigned int random_seed = 0; //0 = seed from the clock.
+    unsigned int run_time = 10000;//50000;
+    unsigned int output_interval = 250;//250;
+    unsigned int burn_in_period = 3000;//3000;
+    unsigned int num_hosts = 8000;
+    unsigned int initial_num_mosquitoes = 8000;
+    unsigned int initial_antigen_diversity = 2500;
+    unsigned int initial_num_strains = 40;
+    unsigned int initial_num_mosquito_infections = 500;
+    unsigned int num_phenotypes = 50000;
+    unsigned int num_genotype_only_bits = 7;
+    unsigned int genotypic_space_size = std::numeric_limits<unsigned int>::max();
+    unsigned int repertoire_size = 60;
+    unsigned int mean_mosquito_life_expectancy = 32; //In days, Bellan2010.
+    unsigned int mosquito_eip = 10; //Extrinsic inoculation period in days, Deitz1974.
+    unsigned int reintroduction_interval = 0; //How often is a random extinct initial strain reintroduced? 0 = never. NOTE: only works when intra and inter recombination rate are 0.0, AND unique_initial_strains = 0.
+
+    float bite_rate = 0.12f;
+    float intergenic_recombination_p = 0.01f;
+    float intragenic_recombination_p = 0.002f;
+    float recombination_scale = 50.0f;
+    float infection_duration_scale = 2.0f;
+    float infectivity_scale = 0.5f;
+    float cross_immunity = 0.0f;
+    float immunityScale = 1.0f; //Linear scaling of immunity.
 
     ////Output management
-    static bool output_antigen_frequency; //Outputs the frequency with which antigens are present in the parasite population.
-    static bool output_host_susceptibility; //Outputs a number (ranging between 0 and 1) indicating the mean susceptibility of the host popualtion to currently circulating parasite population.
-    static bool output_strain_structure; //Output a list of all strain vector frequencies each output interval (uses multiple files).
+    bool output_antigen_frequency = false; //Outputs the frequency with which antigens are present in the parasite population.
+    bool sparse_antigen_frequency = false; //With output_antigen_frequency, write only the changes since the previous output, as "output index, antigen, count" lines appended to _circulating_antigen_frequency_changes.csv as the run goes, instead of the dense matrix.
+    unsigned int output_top_antigens = 0; //If > 0, write this many of the most abundant antigens at each output, as "output index, antigen, count" lines appended to _top_antigens.csv, plus the largest count of any unlisted antigen (top_antigens_bound series).
+    bool output_distributions = false; //Outputs the 5th, 25th, 50th, 75th and 95th percentiles of infection duration, host age at infection (days, both over each output interval) and per host total immunity (at each output), estimated with quantile sketches.
+    bool output_host_susceptibility = false; //Outputs a number (ranging between 0 and 1) indicating the mean susceptibility of the host popualtion to currently circulating parasite population.
+    bool output_strain_structure = false; //Output the frequency of every strain repertoire each output interval, to _strain_structure.tdmc (see strain_census.hpp).
+    std::string output_format = "csv"; //csv: one text file per series. binary: a single columnar file, runName.tdmc (see columnar_file.hpp). npy / npz: numpy arrays (see npy_file.hpp).
+    bool stream_output = false; //Append each output interval to the output files as the run goes (on a background thread) rather than keeping everything in memory until the end.
+    bool output_profile = true; //Writes per phase, per thread busy / idle times and work counts for the simulated day to _profile.csv (see phase_profiler.hpp). Cheap enough to leave on.
+    bool profile_counters = false; //With output_profile, also count cycles, instructions, LLC / dTLB misses and branch misses per phase with Linux perf_event_open (see perf_counters.hpp).
+    unsigned int trace_first_day = 0; //With trace_num_days > 0, records what every thread does in each phase of days [trace_first_day, trace_first_day+trace_num_days) to _trace.json (Chrome trace format, see phase_trace.hpp).
+    unsigned int trace_num_days = 0;
+    unsigned int trace_buffer_events = 65536; //Per thread. Once full, the oldest trace events are overwritten.
+    unsigned int audit_interval = 0; //If > 0, every this many days recount the antigens of all live infections and compare with the DiversityMonitor, logging drift to _diversity_audit.csv (see diversity_audit.hpp). 0 = never.
+    bool audit_self_heal = false; //Rebuild the DiversityMonitor from the recount when an audit finds drift.
+    float audit_budget = 0.01f; //Audits are postponed to keep their cost below this fraction of the run's wall time. 0 = no limit.
+    bool output_memory = true; //At each output, append the bytes held by hosts, mosquitoes, diversity monitoring, output and strain structure, with the process's RSS and peak RSS, to _memory.csv (see memory_report.hpp).
+    bool dry_run = false; //Print the projected (worst case) memory use for these parameters and exit without running the model.
+    unsigned int checkpoint_interval = 0; //If > 0, every this many days save the whole model state to _checkpoint.bin (replacing the previous one), see checkpoint.hpp. 0 = never.
+    std::string resume_from = ""; //Checkpoint file to continue a run from, instead of initialising the model. Give the same parameters and adaptors as the run that saved it (run_time may be longer); the values adaptors adjust are restored from the checkpoint.
+    std::string scenario_file = ""; //If set, run to the end of the burn-in once, then branch into the scenarios this file lists (one per line: a name, then parameter / adaptor token value pairs as on the command line), each continuing in its own process with output files named runName_name. See branching.hpp.
+    unsigned int max_concurrent_scenarios = 0; //Scenarios run one per process, each single threaded, this many at once. 0 = as many as the threads the burn-in ran with.
+    unsigned int ensemble_size = 0; //If > 1, run this many replicates in one process, each on one thread with random_seed+r (r = 0, 1, ...) and output files named runName_r<r>, plus across replicate means and quantiles of every series (runName_ensemble_<series>.csv). See ensemble.hpp.
 
     ////Dynamic support parameters.
     //Dynamic mosquito population (MosquitoPopulationAdaptor).
-    static bool dyn_num_mosquitoes; //Used to know whether or not to output timeseries of number of mosquitoes for example.
-    static unsigned int max_num_mosquitoes; //Used to reserve space in vectors.
+    bool dyn_num_mosquitoes = false; //Used to know whether or not to output timeseries of number of mosquitoes for example.
+    unsigned int max_num_mosquitoes = initial_num_mosquitoes; //Fixed capacity of the mosquito population. Raised to initial_num_mosquitoes / MosquitoPopulationAdaptor targets if smaller.
     //Dynamic bite rate (BiteRateAdaptor).
-    static bool dyn_bite_rate;
-    static bool dyn_intragenic_recombination_p;
+    bool dyn_bite_rate = false;
+    bool dyn_intragenic_recombination_p = false;
 
-    static unsigned int output_size_needed; //Calculated as a derived parameter based on any output_interval adaptors
+    unsigned int output_size_needed = 0; //Calculated as a derived parameter based on any output_interval adaptors
 
-    static std::array<float, 2> recombination_cumu_p;
+    Antigen genotype_mask = 0; //Derived from num_genotype_only_bits: selects the non-phenotype coding bits of an antigen.
 
-    static BITE_FREQUENCY_TABLE cumulativeBiteFrequencyDistribution;
-    static std::list<float> immunityMask;
+    std::array<float, 2> recombination_cumu_p;
 
-    static std::list<Adaptor*> adaptors;
+    BITE_FREQUENCY_TABLE cumulativeBiteFrequencyDistribution;
+    std::list<float> immunityMask;
 
-    static std::string run_name() { return runName; }
-    static std::string file_path() { return filePath; }
+    std::list<Adaptor*> adaptors;
+
+    std::string run_name() const { return runName; }
+    std::string file_path() const { return filePath; }
 
     //Functions
-    static void set_param(const std::string name, const std::string value);
+    void set_param(const std::string name, const std::string value);
+
+    void add_adaptor(Adaptor* adaptor);
+    bool is_compatable_adaptor(const Adaptor& adaptor);
 
-    static void add_adaptor(Adaptor* adaptor);
-    static bool is_compatable_adaptor(const Adaptor& adaptor);
+    void update_adaptors(const unsigned int t);
 
-    static void update_adaptors(const unsigned int t);
+    bool recalculate_derived_parameters();
+    bool recalculate_recombination_distributions();
+    void recalculate_cumulative_bite_frequency_distribution();
+    const BITE_FREQUENCY_TABLE& get_cumulative_bite_frequency_distribution() const { return cumulativeBiteFrequencyDistribution; }
+    void recalculate_output_array_size_needed();
+    void recalculate_immunity_mask();
+    void recalculate_genotype_mask();
+    const std::list<float>& get_immunity_mask() const { return immunityMask; }
 
-    static bool recalculate_derived_parameters();
-    static bool recalculate_recombination_distributions();
-    static void recalculate_cumulative_bite_frequency_distribution();
-    static const BITE_FREQUENCY_TABLE& get_cumulative_bite_frequency_distribution() { return cumulativeBiteFrequencyDistribution; }
-    static void recalculate_output_array_size_needed();
-    static void recalculate_immunity_mask();
-    static const std::list<float>& get_immunity_mask() { return immunityMask; }
+    //Checkpointing: the values adaptors adjust during a run and the adaptors' own progress. The adaptors must match those saved.
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in);
 
+    ParamManager() { recalculate_derived_parameters(); }
     ParamManager(ParamManager const&) = delete; //disable copy construction
     void operator=(ParamManager const&) = delete; //disable copy assignment
 
@@ -0,0 +1,119 @@
+#include "perf_counters.hpp"
+#include <cerrno>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* PerfCounters::counter_name(const Counter counter)
+{
+    switch (counter)
+    {
+    case CYCLES: return "cycles";
+    case INSTRUCTIONS: return "instructions";
+    case LLC_MISSES: return "llc_misses";
+    case DTLB_MISSES: return "dtlb_misses";
+    case BRANCH_MISSES: return "branch_misses";
+    default: return "unknown";
+    }
+}
+
+PerfCounters::PerfCounters()
+{
+    fds.fill(-1);
+    slots.fill(-1);
+}
+
+PerfCounters::~PerfCounters()
+{
+    close();
+}
+
+#ifdef __linux__
+bool PerfCounters::open()
+{
+    close();
+
+    const uint64_t cacheMissRead = ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) | ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const struct { uint32_t type; uint64_t config; } events[NUM_COUNTERS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cacheMissRead},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cacheMissRead},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    for (unsigned int c=0; c<NUM_COUNTERS; ++c)
+    {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[c].type;
+        attr.config = events[c].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        //pid 0, cpu -1: the calling thread on any CPU.
+        const int fd = syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+        if (fd < 0) {
+            if (error.empty())
+                error = std::string(counter_name((Counter)c)) + ": " + std::strerror(errno);
+            continue;
+        }
+        if (groupFd < 0)
+            groupFd = fd;
+        fds[c] = fd;
+        slots[c] = numOpen++;
+    }
+    return is_open();
+}
+
+void PerfCounters::close()
+{
+    for (int& fd : fds)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+    slots.fill(-1);
+    groupFd = -1;
+    numOpen = 0;
+}
+
+bool PerfCounters::read(Values& values) const
+{
+    values.fill(0);
+    if (!is_open())
+        return false;
+
+    uint64_t buffer[1+NUM_COUNTERS]; //Number of counters, then their values in the order they joined the group.
+    if (::read(groupFd, buffer, sizeof(buffer)) < (ssize_t)(sizeof(uint64_t)*(1+numOpen)))
+        return false;
+    for (unsigned int c=0; c<NUM_COUNTERS; ++c)
+    {
+        if (slots[c] >= 0)
+            values[c] = buffer[1+slots[c]];
+    }
+    return true;
+}
+#else
+bool PerfCounters::open()
+{
+    error = "hardware counters need Linux perf_event_open";
+    return false;
+}
+
+void PerfCounters::close()
+{
+}
+
+bool PerfCounters::read(Values& values) const
+{
+    values.fill(0);
+    return false;
+}
+#endif
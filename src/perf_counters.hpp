@@ -0,0 +1,38 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+//Hardware performance counters of the calling thread, via Linux perf_event_open (user space only). The counters are opened as one
+//group, so they are scheduled together and read with a single system call. A counter the CPU / kernel doesn't offer is left out.
+//If perf_event_paranoid or a container forbids them, none are open and read() fails. Without Linux nothing is ever available.
+class PerfCounters
+{
+public:
+    enum Counter { CYCLES, INSTRUCTIONS, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+    typedef std::array<uint64_t, NUM_COUNTERS> Values;
+    static const char* counter_name(const Counter counter);
+
+private:
+    int groupFd = -1;
+    std::array<int, NUM_COUNTERS> fds;
+    std::array<int, NUM_COUNTERS> slots; //Position of each counter in a group read, -1 if not open.
+    unsigned int numOpen = 0;
+    std::string error;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    void operator=(const PerfCounters&) = delete;
+
+    //Starts counting for the calling thread (counters follow the thread, whichever CPU it runs on). Returns false if none could be opened.
+    bool open();
+    void close();
+    bool is_open() const { return numOpen != 0; }
+    bool available(const Counter counter) const { return slots[counter] >= 0; }
+    const std::string& get_error() const { return error; } //Why the first counter which failed to open did so.
+
+    //Totals since open(). Counters which aren't available read 0.
+    bool read(Values& values) const;
+};
@@ -0,0 +1,209 @@
+#include "phase_profiler.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+const char* PhaseProfiler::phase_name(const Phase phase)
+{
+    switch (phase)
+    {
+    case UPDATE_INFECTIONS: return "update_infections";
+    case AGE_HOSTS: return "age_hosts";
+    case AGE_MOSQUITOES: return "age_mosquitoes";
+    case FEED_MOSQUITOES: return "feed_mosquitoes";
+    case ATTEMPT_REINTRODUCTION: return "attempt_reintroduction";
+    case APPEND_OUTPUT: return "append_output";
+    case UPDATE_TIME: return "update_time";
+    case WRITE_CHECKPOINT: return "write_checkpoint";
+    case EXPORT_OUTPUT: return "export_output";
+    default: return "unknown";
+    }
+}
+
+void PhaseProfiler::reset(const bool _enabled, const bool _countersEnabled)
+{
+    enabled = _enabled;
+    countersEnabled = _enabled && _countersEnabled;
+    ThreadTimes zero;
+    zero.calls.fill(0);
+    zero.busyNs.fill(0);
+    zero.idleNs.fill(0);
+    zero.events.fill(0);
+    PerfCounters::Values noCounts;
+    noCounts.fill(0);
+    zero.counts.fill(noCounts);
+    zero.countsAtStart = noCounts;
+    zero.countersOpened = false;
+    threads.assign(utilities::max_threads(), zero);
+
+    counters.clear();
+    for (unsigned int t=0; t<threads.size() && countersEnabled; ++t)
+        counters.push_back(std::unique_ptr<PerfCounters>(new PerfCounters()));
+}
+
+void PhaseProfiler::start(const Phase phase)
+{
+    if (!timing())
+        return;
+    const unsigned int t = utilities::thread_num();
+    ThreadTimes& times = threads[t];
+    if (countersEnabled) {
+        //Counters count the thread which opens them, so each thread opens its own.
+        if (!times.countersOpened) {
+            counters[t]->open();
+            times.countersOpened = true;
+        }
+        counters[t]->read(times.countsAtStart);
+    }
+    times.started = Clock::now();
+}
+
+void PhaseProfiler::stop(const Phase phase, const uint64_t events)
+{
+    if (!timing())
+        return;
+    const Clock::time_point now = Clock::now();
+    const unsigned int t = utilities::thread_num();
+    ThreadTimes& times = threads[t];
+    times.busyNs[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - times.started).count();
+    times.calls[phase] += 1;
+    times.events[phase] += events;
+    if (countersEnabled) {
+        PerfCounters::Values countsNow;
+        if (counters[t]->read(countsNow)) {
+            for (unsigned int c=0; c<PerfCounters::NUM_COUNTERS; ++c)
+                times.counts[phase][c] += countsNow[c] - times.countsAtStart[c];
+        }
+    }
+    if (trace.is_active())
+        trace.record(phase_name(phase), false, times.started, now, events);
+}
+
+void PhaseProfiler::barrier(const Phase phase)
+{
+    if (!timing()) {
+        #pragma omp barrier
+        return;
+    }
+
+    const Clock::time_point arrived = Clock::now();
+    #pragma omp barrier
+    const Clock::time_point now = Clock::now();
+    threads[utilities::thread_num()].idleNs[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - arrived).count();
+    if (trace.is_active())
+        trace.record(phase_name(phase), true, arrived, now, 0);
+}
+
+bool PhaseProfiler::counter_available(const PerfCounters::Counter counter) const
+{
+    for (const std::unique_ptr<PerfCounters>& threadCounters : counters)
+    {
+        if (threadCounters->available(counter))
+            return true;
+    }
+    return false;
+}
+
+uint64_t PhaseProfiler::total_agent_days() const
+{
+    uint64_t agentDays = 0;
+    for (const ThreadTimes& times : threads)
+        agentDays += times.events[AGE_HOSTS] + times.events[AGE_MOSQUITOES];
+    return agentDays;
+}
+
+void PhaseProfiler::write(const std::string& filename, const unsigned int days, const double wallSeconds) const
+{
+    std::ofstream file;
+    file.open(filename, std::ofstream::out | std::ofstream::trunc);
+    file << "phase, thread, calls, busy_seconds, idle_seconds, events";
+    if (countersEnabled) {
+        file << ", cycles, instructions, ipc, llc_misses, dtlb_misses, branch_misses, llc_misses_per_agent_day, dtlb_misses_per_agent_day, branch_misses_per_agent_day";
+    }
+    file << "\n";
+
+    const double agentDays = std::max<uint64_t>(1, total_agent_days());
+    const PerfCounters::Counter misses[] = {PerfCounters::LLC_MISSES, PerfCounters::DTLB_MISSES, PerfCounters::BRANCH_MISSES};
+
+    for (unsigned int p=0; p<NUM_PHASES; ++p)
+    {
+        for (unsigned int t=0; t<threads.size(); ++t)
+        {
+            const ThreadTimes& times = threads[t];
+            if (times.calls[p] == 0 && times.idleNs[p] == 0)
+                continue; //Thread never ran or waited in this phase (e.g. not part of the team).
+            file << phase_name((Phase)p) << ", " << t << ", " << times.calls[p] << ", " << times.busyNs[p]*1e-9 << ", "
+                 << times.idleNs[p]*1e-9 << ", " << times.events[p];
+
+            if (countersEnabled) {
+                const PerfCounters::Values& counts = times.counts[p];
+                for (unsigned int c=0; c<PerfCounters::NUM_COUNTERS; ++c)
+                {
+                    file << ", ";
+                    if (counter_available((PerfCounters::Counter)c))
+                        file << counts[c];
+                    if (c == PerfCounters::INSTRUCTIONS) {
+                        file << ", ";
+                        if (counter_available(PerfCounters::CYCLES) && counter_available(PerfCounters::INSTRUCTIONS) && counts[PerfCounters::CYCLES] > 0)
+                            file << (double)counts[PerfCounters::INSTRUCTIONS] / counts[PerfCounters::CYCLES];
+                    }
+                }
+                for (PerfCounters::Counter counter : misses)
+                {
+                    file << ", ";
+                    if (counter_available(counter))
+                        file << counts[counter] / agentDays;
+                }
+            }
+            file << "\n";
+        }
+    }
+    file << "run, all, " << days << ", " << wallSeconds << ", 0, 0";
+    if (countersEnabled)
+        file << ", , , , , , , , , ";
+    file << "\n";
+
+    file.flush();
+    file.close();
+}
+
+void PhaseProfiler::print_counter_summary() const
+{
+    if (!countersEnabled)
+        return;
+    bool anyAvailable = false;
+    for (unsigned int c=0; c<PerfCounters::NUM_COUNTERS; ++c)
+        anyAvailable = anyAvailable || counter_available((PerfCounters::Counter)c);
+    for (const std::unique_ptr<PerfCounters>& threadCounters : counters)
+    {
+        if (!threadCounters->get_error().empty()) {
+            std::cout << "Hardware counters " << (anyAvailable ? "partly" : "not") << " available (" << threadCounters->get_error() << ")." << std::endl;
+            break;
+        }
+    }
+    if (!anyAvailable)
+        return;
+
+    const double agentDays = std::max<uint64_t>(1, total_agent_days());
+    for (unsigned int p=0; p<NUM_PHASES; ++p)
+    {
+        PerfCounters::Values totals;
+        totals.fill(0);
+        for (const ThreadTimes& times : threads)
+        {
+            for (unsigned int c=0; c<PerfCounters::NUM_COUNTERS; ++c)
+                totals[c] += times.counts[p][c];
+        }
+        if (totals[PerfCounters::CYCLES] == 0 && totals[PerfCounters::LLC_MISSES] == 0)
+            continue;
+
+        std::cout << phase_name((Phase)p) << ": ";
+        if (counter_available(PerfCounters::CYCLES) && counter_available(PerfCounters::INSTRUCTIONS) && totals[PerfCounters::CYCLES] > 0)
+            std::cout << "IPC " << (double)totals[PerfCounters::INSTRUCTIONS] / totals[PerfCounters::CYCLES] << " ";
+        if (counter_available(PerfCounters::LLC_MISSES))
+            std::cout << "LLC misses per agent-day " << totals[PerfCounters::LLC_MISSES] / agentDays;
+        std::cout << "\n";
+    }
+    std::cout.flush();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "perf_counters.hpp"
+#include "phase_trace.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Wall clock time and work counts for each phase of the simulated day (output_profile), per thread. Each thread times its own share
+//of a phase (busy) and how long it then waits at the barrier which ends the phase (idle), so load imbalance shows up as idle time.
+//A thread which doesn't run a 'single' phase spends it all idle. Barriers inside append_output are counted as busy.
+//Timing costs a couple of clock reads per thread per phase per day, so this is cheap enough to leave on.
+//Written to _profile.csv as "phase, thread, calls, busy_seconds, idle_seconds, events", one line per phase per thread, then a
+//"run, all" line with the number of days simulated (calls) and the wall time of the time loop (busy_seconds).
+//The same start / stop / barrier calls feed the optional timeline (see phase_trace.hpp).
+//With profile_counters, each thread also reads its hardware counters (see perf_counters.hpp) at the start and end of its share of each
+//phase, adding cycles, instructions, ipc, llc_misses, dtlb_misses, branch_misses and the misses per agent-day (host and mosquito days
+//aged over the whole run, so a phase's per thread lines add up) to _profile.csv. Counters which can't be opened are left blank.
+class PhaseProfiler
+{
+public:
+    enum Phase { UPDATE_INFECTIONS, AGE_HOSTS, AGE_MOSQUITOES, FEED_MOSQUITOES, ATTEMPT_REINTRODUCTION, APPEND_OUTPUT, UPDATE_TIME, WRITE_CHECKPOINT, EXPORT_OUTPUT, NUM_PHASES };
+    static const char* phase_name(const Phase phase);
+
+private:
+    typedef PhaseTrace::Clock Clock;
+
+    struct ThreadTimes
+    {
+        std::array<uint64_t, NUM_PHASES> calls, busyNs, idleNs, events;
+        Clock::time_point started;
+        std::array<PerfCounters::Values, NUM_PHASES> counts;
+        PerfCounters::Values countsAtStart;
+        bool countersOpened;
+        char padding[64]; //Keeps the counters of adjacent threads on separate cache lines.
+    };
+
+    bool enabled = false;
+    bool countersEnabled = false;
+    std::vector<ThreadTimes> threads;
+    std::vector<std::unique_ptr<PerfCounters>> counters; //Per thread, opened by that thread the first time it starts a phase.
+    PhaseTrace trace;
+
+    bool counter_available(const PerfCounters::Counter counter) const; //On any thread.
+    uint64_t total_agent_days() const;
+
+    bool timing() const { return enabled || trace.enabled(); }
+
+public:
+    void reset(const bool _enabled, const bool _countersEnabled = false);
+    bool is_enabled() const { return enabled; }
+    PhaseTrace& get_trace() { return trace; }
+
+    //Called by each thread which takes part in the phase. 'events' counts the work done by that thread (hosts aged, bites, ...).
+    void start(const Phase phase);
+    void stop(const Phase phase, const uint64_t events = 0);
+
+    //An omp barrier, timed as idle time of 'phase'. Must be reached by every thread of the team, like any barrier.
+    void barrier(const Phase phase);
+
+    void write(const std::string& filename, const unsigned int days, const double wallSeconds) const;
+    void print_counter_summary() const; //IPC and LLC misses per agent-day of each phase, over all threads.
+};
@@ -0,0 +1,82 @@
+#include "phase_trace.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+void PhaseTrace::reset(const unsigned int _firstDay, const unsigned int _numDays, const unsigned int bufferEvents)
+{
+    firstDay = _firstDay;
+    numDays = _numDays;
+    origin = Clock::now();
+
+    ThreadBuffer empty;
+    empty.active = enabled() && firstDay == 0;
+    buffers.assign(enabled() ? utilities::max_threads() : 0, empty);
+    for (ThreadBuffer& buffer : buffers)
+        buffer.events.resize(bufferEvents);
+}
+
+void PhaseTrace::set_day(const unsigned int day)
+{
+    if (!enabled())
+        return;
+    ThreadBuffer& buffer = buffers[utilities::thread_num()];
+    buffer.today = day;
+    buffer.active = day >= firstDay && day - firstDay < numDays;
+}
+
+bool PhaseTrace::is_active() const
+{
+    return enabled() && buffers[utilities::thread_num()].active;
+}
+
+void PhaseTrace::record(const char* name, const bool idle, const Clock::time_point start, const Clock::time_point end, const uint64_t count)
+{
+    ThreadBuffer& buffer = buffers[utilities::thread_num()];
+
+    Event& event = buffer.events[buffer.numRecorded % buffer.events.size()];
+    event.name = name;
+    event.idle = idle;
+    event.day = buffer.today;
+    event.start = start;
+    event.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    event.count = count;
+    ++buffer.numRecorded;
+}
+
+//Complete ("X") events in microseconds since reset, one track (tid) per thread.
+void PhaseTrace::write(const std::string& filename) const
+{
+    std::ofstream file;
+    file.open(filename, std::ofstream::out | std::ofstream::trunc);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"transmission diversity model\"}}";
+
+    uint64_t numDropped = 0;
+    for (unsigned int t=0; t<buffers.size(); ++t)
+    {
+        const ThreadBuffer& buffer = buffers[t];
+        file << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << t << ", \"args\": {\"name\": \"thread " << t << "\"}}";
+
+        //Oldest first. Once the buffer has wrapped, the oldest surviving event is the next one to be overwritten.
+        const uint64_t capacity = buffer.events.size();
+        const uint64_t numKept = std::min(buffer.numRecorded, capacity);
+        const uint64_t first = buffer.numRecorded - numKept;
+        numDropped += first;
+        for (uint64_t i=first; i<buffer.numRecorded; ++i)
+        {
+            const Event& event = buffer.events[i % capacity];
+            const double startUs = std::chrono::duration_cast<std::chrono::nanoseconds>(event.start - origin).count() * 1e-3;
+            file << ",\n{\"name\": \"" << (event.idle ? "idle (" : "") << event.name << (event.idle ? ")" : "")
+                 << "\", \"cat\": \"" << (event.idle ? "idle" : "busy") << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << t
+                 << ", \"ts\": " << startUs << ", \"dur\": " << event.durationNs * 1e-3
+                 << ", \"args\": {\"day\": " << event.day << ", \"events\": " << event.count << "}}";
+        }
+    }
+
+    file << "\n], \"otherData\": {\"first_day\": " << firstDay << ", \"num_days\": " << numDays << ", \"dropped_events\": " << numDropped << "}}\n";
+    file.flush();
+    file.close();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Timeline of what each thread was doing over a window of simulated days (trace_first_day, trace_num_days), for load balancing work.
+//PhaseProfiler records a busy event for each thread's share of each phase and an idle event for each of its barrier waits.
+//Each thread writes only to its own ring buffer (trace_buffer_events long, oldest events overwritten), so recording takes no locks.
+//Written to _trace.json in the Chrome trace event format: open it in Perfetto (ui.perfetto.dev) or chrome://tracing.
+class PhaseTrace
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    struct Event
+    {
+        const char* name;
+        bool idle;
+        unsigned int day;
+        Clock::time_point start;
+        uint64_t durationNs;
+        uint64_t count;
+    };
+
+    struct ThreadBuffer
+    {
+        std::vector<Event> events;
+        uint64_t numRecorded = 0;
+        unsigned int today = 0;
+        bool active = false; //Is today inside the window?
+        char padding[64]; //Keeps the write positions of adjacent threads on separate cache lines.
+    };
+
+    unsigned int firstDay = 0;
+    unsigned int numDays = 0;
+    Clock::time_point origin;
+    std::vector<ThreadBuffer> buffers;
+
+public:
+    void reset(const unsigned int _firstDay, const unsigned int _numDays, const unsigned int bufferEvents);
+    bool enabled() const { return numDays != 0; }
+
+    //Every thread keeps its own day, so each must call this as it starts a day. Other threads may already be recording the next day.
+    void set_day(const unsigned int day);
+    bool is_active() const; //Is the calling thread's day inside the window?
+
+    //Records an event on the calling thread's buffer. 'name' must outlive the trace.
+    void record(const char* name, const bool idle, const Clock::time_point start, const Clock::time_point end, const uint64_t count);
+
+    void write(const std::string& filename) const;
+};
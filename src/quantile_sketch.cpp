@@ -0,0 +1,155 @@
+#include "quantile_sketch.hpp"
+#include "checkpoint.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+QuantileSketch::QuantileSketch(const unsigned int _k) : k(_k), levels(1), coinState(0x9E3779B97F4A7C15ULL)
+{
+}
+
+//Capacities shrink geometrically (by 2/3) going down from the top level, with a minimum of 2.
+unsigned int QuantileSketch::level_capacity(const unsigned int level) const
+{
+    const unsigned int depth = levels.size() - 1 - level;
+    return std::max(2u, (unsigned int)std::ceil(k * std::pow(2.0/3.0, depth)));
+}
+
+unsigned int QuantileSketch::total_capacity() const
+{
+    unsigned int capacity = 0;
+    for (unsigned int h=0; h<levels.size(); ++h)
+        capacity += level_capacity(h);
+    return capacity;
+}
+
+unsigned int QuantileSketch::size() const
+{
+    unsigned int n = 0;
+    for (const std::vector<float>& level : levels)
+        n += level.size();
+    return n;
+}
+
+bool QuantileSketch::flip_coin()
+{
+    //xorshift64
+    coinState ^= coinState << 13;
+    coinState ^= coinState >> 7;
+    coinState ^= coinState << 17;
+    return coinState & 1;
+}
+
+void QuantileSketch::compress()
+{
+    while (size() > total_capacity())
+    {
+        for (unsigned int h=0; h<levels.size(); ++h)
+        {
+            if (levels[h].size() < level_capacity(h))
+                continue;
+
+            if (h+1 == levels.size())
+                levels.push_back(std::vector<float>());
+
+            std::vector<float>& level = levels[h];
+            std::sort(level.begin(), level.end());
+
+            //An odd item out stays behind.
+            float leftOver = 0.0f;
+            const bool odd = level.size() % 2 == 1;
+            if (odd) {
+                leftOver = level.back();
+                level.pop_back();
+            }
+
+            for (unsigned int i=flip_coin(); i<level.size(); i+=2)
+                levels[h+1].push_back(level[i]);
+            level.clear();
+            if (odd)
+                level.push_back(leftOver);
+            break;
+        }
+    }
+}
+
+void QuantileSketch::update(const float value)
+{
+    levels[0].push_back(value);
+    ++count;
+    if (levels[0].size() >= level_capacity(0))
+        compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    while (levels.size() < other.levels.size())
+        levels.push_back(std::vector<float>());
+    for (unsigned int h=0; h<other.levels.size(); ++h)
+        levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+    count += other.count;
+    compress();
+}
+
+void QuantileSketch::clear()
+{
+    levels.assign(1, std::vector<float>());
+    count = 0;
+}
+
+float QuantileSketch::quantile(const double q) const
+{
+    return quantiles(std::vector<double>(1, q))[0];
+}
+
+std::vector<float> QuantileSketch::quantiles(const std::vector<double>& qs) const
+{
+    std::vector<float> result(qs.size(), std::numeric_limits<float>::quiet_NaN());
+    if (empty())
+        return result;
+
+    //Each item in level h has weight 2^h.
+    std::vector<std::pair<float, uint64_t>> weighted;
+    uint64_t totalWeight = 0;
+    for (unsigned int h=0; h<levels.size(); ++h)
+    {
+        for (float value : levels[h])
+            weighted.push_back(std::make_pair(value, 1ull << h));
+        totalWeight += levels[h].size() << h;
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    for (unsigned int i=0; i<qs.size(); ++i)
+    {
+        const double targetRank = qs[i] * totalWeight;
+        uint64_t cumulative = 0;
+        for (const std::pair<float, uint64_t>& item : weighted)
+        {
+            cumulative += item.second;
+            if (cumulative >= targetRank) {
+                result[i] = item.first;
+                break;
+            }
+        }
+        if (qs[i] >= 1.0)
+            result[i] = weighted.back().first;
+    }
+    return result;
+}
+
+void QuantileSketch::save(checkpoint::Writer& out) const
+{
+    out.write(k);
+    out.write_vectors(levels);
+    out.write(count);
+    out.write(coinState);
+}
+
+void QuantileSketch::load(checkpoint::Reader& in)
+{
+    in.read(k);
+    in.read_vectors(levels);
+    in.read(count);
+    in.read(coinState);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace checkpoint { class Writer; class Reader; }
+
+//KLL quantile sketch (Karnin, Lang & Liberty 2016): approximate quantiles of a stream of values in O(k log(n/k)) memory.
+//Values are kept in a hierarchy of compactors, where an item in level h stands for 2^h values. When the sketch is full the lowest full
+//level is sorted and every other item (odd or even, at random) is promoted to the level above. The rank error is roughly 1.7/k.
+//Sketches are mergeable, so each thread can keep its own and they can be combined afterwards.
+//The coin flips come from the sketch's own generator, so using a sketch never changes a model's random number streams.
+class QuantileSketch
+{
+private:
+    unsigned int k;
+    std::vector<std::vector<float>> levels;
+    uint64_t count = 0;
+    uint64_t coinState;
+
+    unsigned int level_capacity(const unsigned int level) const;
+    unsigned int total_capacity() const;
+    unsigned int size() const;
+    void compress(); //Compacts levels until the sketch fits its capacity.
+    bool flip_coin();
+
+public:
+    QuantileSketch(const unsigned int _k = 200);
+
+    void update(const float value);
+    void merge(const QuantileSketch& other);
+    void clear();
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in);
+
+    uint64_t get_count() const { return count; }
+    bool empty() const { return count == 0; }
+
+    //Approximate q quantile (0 <= q <= 1) of the values seen. NaN if there are none.
+    float quantile(const double q) const;
+    std::vector<float> quantiles(const std::vector<double>& qs) const; //Several at once, sorting the sketch only once.
+};
@@ -0,0 +1,65 @@
+#include "sparse_history.hpp"
+#include "checkpoint.hpp"
+#include "memory_report.hpp"
+#include <algorithm>
+
+void SparseHistory::reset(const uint32_t _width)
+{
+    width = _width;
+    latest.assign(width, 0);
+    rowStart.assign(1, 0);
+    changedIndices.clear();
+    changedValues.clear();
+}
+
+void SparseHistory::append(const std::vector<uint32_t>& row)
+{
+    const uint32_t n = std::min<size_t>(row.size(), width);
+    for (uint32_t i=0; i<n; ++i)
+    {
+        if (row[i] != latest[i]) {
+            changedIndices.push_back(i);
+            changedValues.push_back(row[i]);
+            latest[i] = row[i];
+        }
+    }
+    for (uint32_t i=n; i<width; ++i)
+    {
+        if (latest[i] != 0) {
+            changedIndices.push_back(i);
+            changedValues.push_back(0);
+            latest[i] = 0;
+        }
+    }
+    rowStart.push_back(changedIndices.size());
+}
+
+void SparseHistory::drop_rows()
+{
+    rowStart.assign(1, 0);
+    changedIndices.clear();
+    changedValues.clear();
+}
+
+uint64_t SparseHistory::memory_bytes() const
+{
+    return memory::vector_bytes(latest) + memory::vector_bytes(rowStart) + memory::vector_bytes(changedIndices) + memory::vector_bytes(changedValues);
+}
+
+void SparseHistory::save(checkpoint::Writer& out) const
+{
+    out.write(width);
+    out.write_vector(latest);
+    out.write_vector(rowStart);
+    out.write_vector(changedIndices);
+    out.write_vector(changedValues);
+}
+
+void SparseHistory::load(checkpoint::Reader& in)
+{
+    in.read(width);
+    in.read_vector(latest);
+    in.read_vector(rowStart);
+    in.read_vector(changedIndices);
+    in.read_vector(changedValues);
+}
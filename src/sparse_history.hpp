@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace checkpoint { class Writer; class Reader; }
+
+//History of a fixed width vector (e.g. antigen frequencies) sampled over time, stored as the changes since the previous sample.
+//Each row is a CSR style list of (index, new value) for the entries which changed, so memory scales with the number of changes rather
+//than with rows*width. Only the latest row is held densely.
+class SparseHistory
+{
+private:
+    uint32_t width = 0;
+    std::vector<uint32_t> latest; //Dense copy of the latest row (all zeros before the first).
+    std::vector<uint64_t> rowStart; //Row r's changes are [rowStart[r], rowStart[r+1]).
+    std::vector<uint32_t> changedIndices;
+    std::vector<uint32_t> changedValues;
+
+public:
+    SparseHistory() : rowStart(1, 0) {  }
+
+    void reset(const uint32_t _width); //Clears everything.
+    void append(const std::vector<uint32_t>& row); //Rows shorter than width are padded with 0.
+    void drop_rows(); //Forgets the stored rows (e.g. once written) but keeps the latest row, so later rows still delta against it.
+
+    uint32_t get_width() const { return width; }
+    uint64_t num_rows() const { return rowStart.size()-1; }
+    uint64_t num_changes() const { return changedIndices.size(); }
+    const std::vector<uint32_t>& get_latest() const { return latest; }
+    uint64_t memory_bytes() const;
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in);
+
+    //Calls fn(index, value) for each entry changed in row r.
+    template <typename Function>
+    void for_each_change(const uint64_t r, Function fn) const
+    {
+        for (uint64_t i=rowStart[r]; i<rowStart[r+1]; ++i)
+            fn(changedIndices[i], changedValues[i]);
+    }
+
+    //Calls fn(row) with each stored row in turn, reconstructed densely. Assumes the stored rows start from zeros (i.e. nothing dropped).
+    template <typename Function>
+    void for_each_row(Function fn) const
+    {
+        std::vector<uint32_t> row(width, 0);
+        for (uint64_t r=0; r<num_rows(); ++r)
+        {
+            for_each_change(r, [&row](const uint32_t index, const uint32_t value) { row[index] = value; });
+            fn(row);
+        }
+    }
+
+    //Calls fn(index, values) for each index in turn, where values holds that entry in every stored row (i.e. the transpose).
+    //Changes are first regrouped by index, so this is O(changes + width*rows) time and O(changes + rows) memory.
+    template <typename Function>
+    void for_each_column(Function fn) const;
+};
+
+template <typename Function>
+void SparseHistory::for_each_column(Function fn) const
+{
+    //Counting sort of the changes by index, keeping row order within each index.
+    std::vector<uint64_t> columnStart(width+1, 0);
+    for (uint32_t index : changedIndices)
+        ++columnStart[index+1];
+    for (uint32_t c=0; c<width; ++c)
+        columnStart[c+1] += columnStart[c];
+
+    std::vector<uint32_t> changeRows(changedIndices.size());
+    std::vector<uint32_t> changeValues(changedIndices.size());
+    std::vector<uint64_t> next(columnStart.begin(), columnStart.end()-1);
+    for (uint64_t r=0; r<num_rows(); ++r)
+    {
+        for_each_change(r, [&](const uint32_t index, const uint32_t value) {
+            changeRows[next[index]] = r;
+            changeValues[next[index]] = value;
+            ++next[index];
+        });
+    }
+
+    std::vector<uint32_t> values(num_rows());
+    for (uint32_t c=0; c<width; ++c)
+    {
+        uint32_t value = 0;
+        uint64_t i = columnStart[c];
+        for (uint64_t r=0; r<num_rows(); ++r)
+        {
+            if (i < columnStart[c+1] && changeRows[i] == r)
+                value = changeValues[i++];
+            values[r] = value;
+        }
+        fn(c, values);
+    }
+}
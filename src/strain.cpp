@@ -1,92 +1,97 @@
 #include "strain.hpp"
-#include "param_manager.hpp"
-#include "utilities.hpp"
+#include "model_context.hpp"
 #include <sstream>
 #include <algorithm>
 
 
-const Antigen GENOTYPE_MASK = init_genotype_mask();
-
-Antigen init_genotype_mask()
-{
-    Antigen mask = 0;
-    for (unsigned int i=0; i<ParamManager::num_genotype_only_bits; ++i)
-    {
-        mask = mask << 1;
-        mask+=1;
-    }
-    return mask;
-}
-
 //Returns just the first NUM_GENOTYPE_ONLY_BITS bits, referring to the non-phenotype coding portion of the antigen.
-Antigen get_genotype_id(const Antigen antigen)
+Antigen get_genotype_id(const ParamManager& params, const Antigen antigen)
 {
-    return antigen & GENOTYPE_MASK;
+    return antigen & params.genotype_mask;
 }
 
 //Takes the whole antigen and returns phenotype ID only.
-Antigen get_phenotype_id(const Antigen antigen)
+Antigen get_phenotype_id(const ParamManager& params, const Antigen antigen)
 {
-    return (antigen >> ParamManager::num_genotype_only_bits) % ParamManager::num_phenotypes;
+    return (antigen >> params.num_genotype_only_bits) % params.num_phenotypes;
 }
 
-std::string strain_phenotype_str(const Strain& strain)
+std::string strain_phenotype_str(const ParamManager& params, const Strain& strain)
 {
     std::ostringstream oss;
     for (const Antigen antigen : strain)
-        oss << get_phenotype_id(antigen) << " ";
+        oss << get_phenotype_id(params, antigen) << " ";
     return oss.str();
 }
 
-std::string strain_phenotype_str_ordered(const Strain& strain)
+std::string strain_phenotype_str_ordered(const ParamManager& params, const Strain& strain)
 {
     //sort strain
     Strain orderedStrain = strain;
     std::sort(orderedStrain.begin(), orderedStrain.end());
 
-    return strain_phenotype_str(orderedStrain);
+    return strain_phenotype_str(params, orderedStrain);
+}
+
+StrainHash strain_phenotype_hash(const ParamManager& params, const Strain& strain, std::vector<Antigen>& phenotypes)
+{
+    phenotypes.clear();
+    for (const Antigen antigen : strain)
+        phenotypes.push_back(get_phenotype_id(params, antigen));
+    std::sort(phenotypes.begin(), phenotypes.end());
+
+    //Two independently seeded splitmix64 chains.
+    StrainHash hash = {0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL ^ phenotypes.size()};
+    for (const Antigen phenotype : phenotypes)
+    {
+        hash.hi = utilities::splitmix64(hash.hi ^ phenotype);
+        hash.lo = utilities::splitmix64(hash.lo + phenotype*0xC2B2AE3D27D4EB4FULL);
+    }
+    return hash;
 }
 
 //Returns a random antigen from the whole of genotypic / antigenic space.
-Antigen random_antigen()
+Antigen random_antigen(ModelContext& ctx)
 {
-    return utilities::urandom(0, ParamManager::genotypic_space_size);
+    return ctx.rng().urandom(0, ctx.params.genotypic_space_size);
 }
 
 //Generates a strain from the given pool of antigens.
-Strain strain_from_antigen_pool(const std::vector<Antigen>& pool)
+Strain strain_from_antigen_pool(ModelContext& ctx, const std::vector<Antigen>& pool)
 {
     //Strain strain(REPERTOIRE_SIZE, 0);
     Strain strain;
-    strain.reserve(ParamManager::repertoire_size);
-    for (unsigned int a=0; a<ParamManager::repertoire_size; ++a)
-        strain.push_back(pool[utilities::random(0, pool.size())]);
+    strain.reserve(ctx.params.repertoire_size);
+    for (unsigned int a=0; a<ctx.params.repertoire_size; ++a)
+        strain.push_back(pool[ctx.rng().random(0, pool.size())]);
     return strain;
 }
 
 //intragenic recombination
-Strain generate_recombinant_strain(const Strain& parent1)
+Strain generate_recombinant_strain(ModelContext& ctx, const Strain& parent1)
 {
+    utilities::RandomStream& rng = ctx.rng();
     Strain recombinant = parent1;
-    for (unsigned int i=0; i<ParamManager::repertoire_size; ++i)
+    for (unsigned int i=0; i<ctx.params.repertoire_size; ++i)
     {
-        float p = utilities::random_float01();
-        if (p <= ParamManager::intragenic_recombination_p) //Intragenic (gene hybrid)
+        float p = rng.random_float01();
+        if (p <= ctx.params.intragenic_recombination_p) //Intragenic (gene hybrid)
         {
-            recombinant[i] = recombinant_antigen(parent1[i], parent1[utilities::random(0, parent1.size())]);
+            recombinant[i] = recombinant_antigen(ctx, parent1[i], parent1[rng.random(0, parent1.size())]);
         }
     }
     return recombinant;
 }
 
 //Intergenic recombination
-Strain generate_recombinant_strain(const Strain& parent1, const Strain& parent2)
+Strain generate_recombinant_strain(ModelContext& ctx, const Strain& parent1, const Strain& parent2)
 {
+    utilities::RandomStream& rng = ctx.rng();
     Strain recombinant = parent1;
-    for (unsigned int i=0; i<ParamManager::repertoire_size; ++i)
+    for (unsigned int i=0; i<ctx.params.repertoire_size; ++i)
     {
-        float p = utilities::random_float01();
-        if (p <= ParamManager::intergenic_recombination_p) //Intergenic (swap gene)
+        float p = rng.random_float01();
+        if (p <= ctx.params.intergenic_recombination_p) //Intergenic (swap gene)
         {
             recombinant[i] = parent2[i];
         }
@@ -94,9 +99,9 @@ Strain generate_recombinant_strain(const Strain& parent1, const Strain& parent2)
     return recombinant;
 }
 
-Antigen recombinant_antigen(const Antigen a, const Antigen b)
+Antigen recombinant_antigen(ModelContext& ctx, const Antigen a, const Antigen b)
 {
-    float antigenDifference = std::abs( (long)get_phenotype_id(a) - (long)get_phenotype_id(b) );
-    long recombinant = a + (utilities::random_float_m1_1() * ParamManager::recombination_scale * antigenDifference);
-    return (Antigen)(recombinant % ParamManager::genotypic_space_size);
+    float antigenDifference = std::abs( (long)get_phenotype_id(ctx.params, a) - (long)get_phenotype_id(ctx.params, b) );
+    long recombinant = a + (ctx.rng().random_float_m1_1() * ctx.params.recombination_scale * antigenDifference);
+    return (Antigen)(recombinant % ctx.params.genotypic_space_size);
 }
@@ -1,27 +1,43 @@
 #pragma once
+#include <cstdint>
+#include <string>
 #include <vector>
 #include "global_typedefs.hpp"
 
-Antigen init_genotype_mask();
+class ParamManager;
+class ModelContext;
 
-Antigen get_phenotype_id(const Antigen antigen);
+Antigen get_phenotype_id(const ParamManager& params, const Antigen antigen);
 
-Antigen get_genotype_id(const Antigen antigen); //Returns just the first NUM_GENOTYPE_ONLY_BITS bits, referring to the non-phenotype coding portion of the antigen.
+Antigen get_genotype_id(const ParamManager& params, const Antigen antigen); //Returns just the first NUM_GENOTYPE_ONLY_BITS bits, referring to the non-phenotype coding portion of the antigen.
 
-std::string strain_phenotype_str(const Strain& strain);
+std::string strain_phenotype_str(const ParamManager& params, const Strain& strain);
 
-std::string strain_phenotype_str_ordered(const Strain& strain);
+std::string strain_phenotype_str_ordered(const ParamManager& params, const Strain& strain);
+
+//128 bit hash of a strain's phenotypes, ignoring their order (i.e. of the phenotypes in strain_phenotype_str_ordered order).
+struct StrainHash
+{
+    uint64_t hi;
+    uint64_t lo;
+    bool operator==(const StrainHash& other) const { return hi == other.hi && lo == other.lo; }
+    bool operator<(const StrainHash& other) const { return hi < other.hi || (hi == other.hi && lo < other.lo); }
+};
+struct StrainHashHasher { size_t operator()(const StrainHash& hash) const { return hash.lo; } };
+
+//'phenotypes' is scratch space, and is left holding the strain's sorted phenotype IDs.
+StrainHash strain_phenotype_hash(const ParamManager& params, const Strain& strain, std::vector<Antigen>& phenotypes);
 
 //Returns a random antigen from the whole of genotypic / antigenic space.
-Antigen random_antigen();
+Antigen random_antigen(ModelContext& ctx);
 
 //Generates a strain from the given pool of antigens.
-Strain strain_from_antigen_pool(const std::vector<Antigen>& pool);
+Strain strain_from_antigen_pool(ModelContext& ctx, const std::vector<Antigen>& pool);
 
 //Intragenic recombination
-Strain generate_recombinant_strain(const Strain& parent1);
+Strain generate_recombinant_strain(ModelContext& ctx, const Strain& parent1);
 
 //Intergenic recombination
-Strain generate_recombinant_strain(const Strain& parent1, const Strain& parent2);
+Strain generate_recombinant_strain(ModelContext& ctx, const Strain& parent1, const Strain& parent2);
 
-Antigen recombinant_antigen(const Antigen a, const Antigen b);
+Antigen recombinant_antigen(ModelContext& ctx, const Antigen a, const Antigen b);
@@ -0,0 +1,136 @@
+#include "strain_census.hpp"
+#include "host_population.hpp"
+#include "memory_report.hpp"
+#include "mosquito_population.hpp"
+#include "param_manager.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+
+void StrainCensus::open(const std::string& filename, const std::string& header)
+{
+    threadTallies.assign(utilities::max_threads(), TallyMap());
+    strainIds.clear();
+    numRecords = 0;
+
+    file.open(filename, header);
+    phenotypesColumn = file.add_column("strain_phenotypes", columnar::Type::UINT32, params.repertoire_size);
+    startColumn = file.add_column("census_start", columnar::Type::UINT32);
+    strainColumn = file.add_column("census_strain", columnar::Type::UINT32);
+    countColumn = file.add_column("census_count", columnar::Type::UINT32);
+}
+
+void StrainCensus::tally(TallyMap& tallies, const Strain& strain, std::vector<Antigen>& phenotypes)
+{
+    Tally& entry = tallies[strain_phenotype_hash(params, strain, phenotypes)];
+    if (entry.count++ == 0)
+        entry.example = &strain;
+}
+
+void StrainCensus::count(const HostPopulation& hosts, const MosquitoPopulation& mosquitoes)
+{
+    TallyMap& tallies = threadTallies[utilities::thread_num()];
+    std::vector<Antigen> phenotypes;
+
+    #pragma omp for schedule(static) nowait
+    for (unsigned int b=0; b<hosts.num_blocks(); ++b)
+    {
+        for (unsigned int h=hosts.block_begin(b); h<hosts.block_end(b); ++h)
+        {
+            for (unsigned int s=0; s<HostPopulation::NUM_INFECTION_SLOTS; ++s)
+            {
+                if (hosts.is_infected(h, s))
+                    tally(tallies, hosts.get_strain(h, s), phenotypes);
+            }
+        }
+    }
+
+    #pragma omp for schedule(static)
+    for (unsigned int b=0; b<mosquitoes.num_blocks(); ++b)
+    {
+        for (unsigned int i=mosquitoes.block_begin(b); i<mosquitoes.block_end(b); ++i)
+        {
+            if (mosquitoes.is_infected(i))
+                tally(tallies, mosquitoes.get_strain(i), phenotypes);
+        }
+    }
+
+    #pragma omp single
+    write_census();
+}
+
+//Merges the per thread tallies and appends them to the file.
+void StrainCensus::write_census()
+{
+    TallyMap merged;
+    for (TallyMap& tallies : threadTallies)
+    {
+        for (const TallyMap::value_type& entry : tallies)
+        {
+            Tally& total = merged[entry.first];
+            if (total.count == 0)
+                total.example = entry.second.example;
+            total.count += entry.second.count;
+        }
+        tallies.clear();
+    }
+
+    //New strains are numbered in hash order, so IDs don't depend on the number of threads.
+    std::vector<StrainHash> newStrains;
+    for (const TallyMap::value_type& entry : merged)
+    {
+        if (strainIds.count(entry.first) == 0)
+            newStrains.push_back(entry.first);
+    }
+    std::sort(newStrains.begin(), newStrains.end());
+
+    std::vector<std::vector<uint32_t>> newPhenotypes(newStrains.size());
+    for (unsigned int i=0; i<newStrains.size(); ++i)
+    {
+        strain_phenotype_hash(params, *merged[newStrains[i]].example, newPhenotypes[i]);
+        const uint32_t id = strainIds.size();
+        strainIds[newStrains[i]] = id;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> records; //strain ID, count
+    records.reserve(merged.size());
+    for (const TallyMap::value_type& entry : merged)
+        records.push_back(std::make_pair(strainIds[entry.first], entry.second.count));
+    std::sort(records.begin(), records.end());
+
+    std::vector<uint32_t> strains, counts;
+    strains.reserve(records.size());
+    counts.reserve(records.size());
+    for (const std::pair<uint32_t, uint32_t>& record : records)
+    {
+        strains.push_back(record.first);
+        counts.push_back(record.second);
+    }
+
+    if (!newPhenotypes.empty())
+        file.append_rows(phenotypesColumn, newPhenotypes);
+    file.append(startColumn, &numRecords, 1);
+    file.append(strainColumn, strains);
+    file.append(countColumn, counts);
+    numRecords += records.size();
+}
+
+void StrainCensus::close()
+{
+    file.close();
+}
+
+//The thread maps are cleared after each census but keep their buckets. strainIds keeps every strain seen so far, so it only grows.
+uint64_t StrainCensus::memory_bytes() const
+{
+    uint64_t bytes = memory::vector_bytes(threadTallies) + memory::unordered_map_bytes(strainIds);
+    for (const TallyMap& tallies : threadTallies)
+        bytes += memory::unordered_map_bytes(tallies);
+    return bytes;
+}
+
+uint64_t StrainCensus::projected_bytes(const uint64_t numStrains, const unsigned int numThreads)
+{
+    const uint64_t perStrain = sizeof(void*) + memory::node_bytes<std::unordered_map<StrainHash, uint32_t, StrainHashHasher>>();
+    const uint64_t perTally = sizeof(void*) + memory::node_bytes<TallyMap>();
+    return numThreads*(sizeof(TallyMap) + numStrains*perTally) + numStrains*perStrain;
+}
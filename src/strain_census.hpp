@@ -0,0 +1,51 @@
+#pragma once
+#include "columnar_file.hpp"
+#include "strain.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ParamManager;
+class HostPopulation;
+class MosquitoPopulation;
+
+//Counts the distinct strains (by phenotype repertoire, ignoring order) in circulation at each output (output_strain_structure).
+//Each thread counts its share of the hosts / mosquitoes into its own hash map, keyed by StrainHash, and the maps are merged at the end.
+//Everything goes to one columnar file (see columnar_file.hpp / read_columnar_output.py):
+//  strain_phenotypes   width repertoire_size: row i is strain i's sorted phenotype IDs. Strains are numbered as they are first seen.
+//  census_start        one row per output: index of that output's first census record.
+//  census_strain, census_count   one row per record: strain ID and number of infections with that strain, in strain ID order.
+class StrainCensus
+{
+private:
+    struct Tally
+    {
+        unsigned int count;
+        const Strain* example; //Valid until the end of count().
+    };
+    typedef std::unordered_map<StrainHash, Tally, StrainHashHasher> TallyMap;
+
+    const ParamManager& params;
+    std::vector<TallyMap> threadTallies;
+    std::unordered_map<StrainHash, uint32_t, StrainHashHasher> strainIds;
+    uint32_t numRecords = 0;
+
+    columnar::Writer file;
+    unsigned int phenotypesColumn, startColumn, strainColumn, countColumn;
+
+    void tally(TallyMap& tallies, const Strain& strain, std::vector<Antigen>& phenotypes);
+    void write_census();
+
+public:
+    StrainCensus(const ParamManager& _params) : params(_params) {  }
+
+    void open(const std::string& filename, const std::string& header);
+    bool is_open() const { return file.is_open(); }
+
+    //Adds one output's census to the file. Must be called by every thread when called from inside a parallel region.
+    void count(const HostPopulation& hosts, const MosquitoPopulation& mosquitoes);
+    void close();
+
+    uint64_t memory_bytes() const;
+    static uint64_t projected_bytes(const uint64_t numStrains, const unsigned int numThreads); //If every thread sees numStrains distinct strains.
+};
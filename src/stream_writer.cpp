@@ -0,0 +1,182 @@
+#include "stream_writer.hpp"
+#include <stdexcept>
+
+StreamWriter::StreamWriter(const unsigned int _queueCapacity, const std::chrono::milliseconds _flushInterval)
+    : queueCapacity(_queueCapacity), flushInterval(_flushInterval)
+{
+}
+
+StreamWriter::~StreamWriter()
+{
+    close();
+}
+
+void StreamWriter::use_columnar_file(const std::string& filename, const std::string& header)
+{
+    if (is_running() || !series.empty() || hasMatrix)
+        throw std::runtime_error("StreamWriter::use_columnar_file: must be called before anything else is added.");
+
+    columnarFile.open(filename, header);
+    columnarMode = true;
+}
+
+void StreamWriter::add_series(const std::string& name, const std::string& csvFilename, const bool integer)
+{
+    if (is_running())
+        throw std::runtime_error("StreamWriter::add_series: cannot add '" + name + "' after the writer has started.");
+
+    std::unique_ptr<Series> newSeries(new Series());
+    newSeries->integer = integer;
+    if (columnarMode)
+        newSeries->column = columnarFile.add_column(name, integer ? columnar::Type::UINT32 : columnar::Type::FLOAT32);
+    else
+        newSeries->file.open(csvFilename, std::ofstream::out | std::ofstream::trunc);
+    series.push_back(std::move(newSeries));
+}
+
+void StreamWriter::set_matrix(const std::string& name, const std::string& csvFilename, const std::string& delim, const uint32_t width)
+{
+    if (is_running())
+        throw std::runtime_error("StreamWriter::set_matrix: cannot add '" + name + "' after the writer has started.");
+
+    if (columnarMode)
+        matrixColumn = columnarFile.add_column(name, columnar::Type::UINT32, width);
+    else
+        matrixFile.open(csvFilename, std::ofstream::out | std::ofstream::trunc);
+    matrixDelim = delim;
+    hasMatrix = true;
+}
+
+void StreamWriter::start()
+{
+    stopping = false;
+    writerThread = std::thread(&StreamWriter::run, this);
+}
+
+void StreamWriter::push(StreamRecord&& record)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueNotFull.wait(lock, [this]() { return queue.size() < queueCapacity; });
+    queue.push_back(std::move(record));
+    lock.unlock();
+    queueNotEmpty.notify_one();
+}
+
+void StreamWriter::close()
+{
+    if (!is_running())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueNotEmpty.notify_one();
+    writerThread.join();
+
+    if (columnarMode) {
+        columnarFile.close();
+        return;
+    }
+    for (std::unique_ptr<Series>& s : series)
+        s->file.close();
+    if (hasMatrix)
+        matrixFile.close();
+}
+
+//Writer thread.
+void StreamWriter::run()
+{
+    auto lastFlush = std::chrono::steady_clock::now();
+    bool unflushed = false;
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true)
+    {
+        //Wakes up at least once per flushInterval so written records are flushed even if no more arrive.
+        queueNotEmpty.wait_for(lock, flushInterval, [this]() { return !queue.empty() || stopping; });
+
+        while (!queue.empty())
+        {
+            StreamRecord record = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            queueNotFull.notify_one();
+
+            write(record); //Without holding the lock, so the simulation can keep pushing.
+            unflushed = true;
+            lock.lock();
+        }
+
+        if (unflushed && (stopping || std::chrono::steady_clock::now()-lastFlush >= flushInterval))
+        {
+            flush();
+            lastFlush = std::chrono::steady_clock::now();
+            unflushed = false;
+        }
+
+        if (stopping)
+            return;
+    }
+}
+
+void StreamWriter::write(const StreamRecord& record)
+{
+    if (columnarMode) { //Buffered until the next flush, so each flush appends one chunk per column.
+        for (unsigned int i=0; i<series.size() && i<record.values.size(); ++i)
+        {
+            if (series[i]->integer)
+                series[i]->pendingUints.push_back((uint32_t)record.values[i]);
+            else
+                series[i]->pendingFloats.push_back((float)record.values[i]);
+        }
+        if (hasMatrix && !record.matrixRow.empty())
+            pendingMatrixRows.push_back(record.matrixRow);
+        return;
+    }
+
+    for (unsigned int i=0; i<series.size() && i<record.values.size(); ++i)
+    {
+        if (series[i]->integer)
+            series[i]->file << (unsigned long)record.values[i] << "\n";
+        else
+            series[i]->file << (float)record.values[i] << "\n";
+    }
+
+    if (hasMatrix && !record.matrixRow.empty())
+    {
+        for (unsigned int i=0; i<record.matrixRow.size(); ++i)
+        {
+            if (i != 0)
+                matrixFile << matrixDelim;
+            matrixFile << record.matrixRow[i];
+        }
+        matrixFile << "\n";
+    }
+}
+
+void StreamWriter::flush()
+{
+    if (columnarMode) {
+        for (std::unique_ptr<Series>& s : series)
+        {
+            if (s->integer)
+                columnarFile.append(s->column, s->pendingUints);
+            else
+                columnarFile.append(s->column, s->pendingFloats);
+            s->pendingUints.clear();
+            s->pendingFloats.clear();
+        }
+        if (hasMatrix && !pendingMatrixRows.empty()) {
+            columnarFile.append_rows(matrixColumn, pendingMatrixRows);
+            pendingMatrixRows.clear();
+        }
+        columnarFile.flush();
+        return;
+    }
+
+    for (std::unique_ptr<Series>& s : series)
+        s->file.flush();
+    if (hasMatrix)
+        matrixFile.flush();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "columnar_file.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//One output time's worth of streamed output.
+struct StreamRecord
+{
+    std::vector<double> values; //One per series, in the order the series were added.
+    std::vector<unsigned int> matrixRow; //Empty if there is no matrix file.
+};
+
+//Appends output records to their files on a background thread, so results are written as a run goes rather than all at the end.
+//Files are flushed whenever the writer has caught up and hasn't flushed for flushInterval, so at most that much output is lost if the
+//run is killed. push() only blocks if the writer falls more than queueCapacity records behind.
+//By default each series is a CSV file. After use_columnar_file() everything goes to one columnar file instead, one chunk per column per flush.
+class StreamWriter
+{
+private:
+    struct Series
+    {
+        std::ofstream file;
+        bool integer;
+        unsigned int column; //Columnar mode only.
+        std::vector<float> pendingFloats; //Columnar mode: values written since the last flush.
+        std::vector<uint32_t> pendingUints;
+    };
+
+    std::vector<std::unique_ptr<Series>> series;
+    std::ofstream matrixFile;
+    std::string matrixDelim;
+    bool hasMatrix = false;
+    unsigned int matrixColumn;
+    std::vector<std::vector<uint32_t>> pendingMatrixRows;
+
+    bool columnarMode = false;
+    columnar::Writer columnarFile;
+
+    std::deque<StreamRecord> queue;
+    const unsigned int queueCapacity;
+    const std::chrono::milliseconds flushInterval;
+    std::mutex queueMutex;
+    std::condition_variable queueNotEmpty;
+    std::condition_variable queueNotFull;
+    bool stopping = false;
+    std::thread writerThread;
+
+    void run();
+    void write(const StreamRecord& record);
+    void flush();
+
+public:
+    StreamWriter(const unsigned int _queueCapacity = 64, const std::chrono::milliseconds _flushInterval = std::chrono::milliseconds(1000));
+    ~StreamWriter(); //Calls close().
+    StreamWriter(StreamWriter const&) = delete;
+    void operator=(StreamWriter const&) = delete;
+
+    //Files are created (truncated) when they are added. Add everything before start().
+    void use_columnar_file(const std::string& filename, const std::string& header); //Call before adding series.
+    void add_series(const std::string& name, const std::string& csvFilename, const bool integer = false); //CSV: one value per line, like utilities::arrayToFile.
+    void set_matrix(const std::string& name, const std::string& csvFilename, const std::string& delim, const uint32_t width); //CSV: one delimited row per record.
+
+    void start();
+    void push(StreamRecord&& record);
+    void close(); //Writes anything still queued, flushes and joins the writer thread.
+    bool is_running() const { return writerThread.joinable(); }
+};
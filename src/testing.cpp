@@ -1,99 +1,102 @@
 #include "testing.hpp"
-#include "host.hpp"
+#include "host_population.hpp"
 #include "strain.hpp"
 #include "infection.hpp"
-#include "mosquito.hpp"
+#include "mosquito_population.hpp"
 #include "utilities.hpp"
 #include "output.hpp"
 #include "demographic_tools.hpp"
+#include <fstream>
 #include <iostream>
 #include <vector>
 
 #include "model_driver.hpp"
+#include "model_context.hpp"
 #include "global_typedefs.hpp"
 
 void testing::test_diversity_counting()
 {
-    ModelDriver model;
+    ModelContext ctx;
+    ModelDriver model(ctx);
     //ParamManager::recalculate_derived_parameters();
     model.test();
 }
 
-void testing::long_diversity_count(unsigned int& uniqueCount, unsigned int& totalCount, const std::vector<Host>& hosts, const std::vector<Mosquito>& mosquitoes)
+void testing::long_diversity_count(const ParamManager& params, unsigned int& uniqueCount, unsigned int& totalCount, const HostPopulation& hosts, const MosquitoPopulation& mosquitoes)
 {
     std::vector<unsigned int> curAntigenFrequencies;
-    curAntigenFrequencies = std::vector<unsigned int>(ParamManager::num_phenotypes);
+    curAntigenFrequencies = std::vector<unsigned int>(params.num_phenotypes);
 
     uniqueCount = 0;
     totalCount = 0;
 
     //All host infections
-    for (const Host& host : hosts)
+    for (unsigned int iH=0; iH<hosts.size(); ++iH)
     {
-        if (host.infection1.infected) {
-            long_diversity_count_helper(curAntigenFrequencies, uniqueCount, host.infection1.strain, totalCount);
-        }
-        if (host.infection2.infected) {
-            long_diversity_count_helper(curAntigenFrequencies, uniqueCount, host.infection2.strain, totalCount);
+        for (unsigned int s=0; s<HostPopulation::NUM_INFECTION_SLOTS; ++s)
+        {
+            if (hosts.is_infected(iH, s)) {
+                long_diversity_count_helper(params, curAntigenFrequencies, uniqueCount, hosts.get_strain(iH, s), totalCount);
+            }
         }
     }
 
 
     //All mosquito infections
-    for (const Mosquito& mosquito : mosquitoes)
+    for (unsigned int iM=0; iM<mosquitoes.size(); ++iM)
     {
-        if (mosquito.is_active() && mosquito.infection.infected) {
-            long_diversity_count_helper(curAntigenFrequencies, uniqueCount, mosquito.infection.strain, totalCount);
+        if (mosquitoes.is_infected(iM)) {
+            long_diversity_count_helper(params, curAntigenFrequencies, uniqueCount, mosquitoes.get_strain(iM), totalCount);
         }
     }
 }
 
 //Counts total and unique antigens
-void testing::long_diversity_count_helper(std::vector<unsigned int>& antigenFreqs, unsigned int& antigenCounter, const Strain& strain, unsigned int &totalCount)
+void testing::long_diversity_count_helper(const ParamManager& params, std::vector<unsigned int>& antigenFreqs, unsigned int& antigenCounter, const Strain& strain, unsigned int &totalCount)
 {
     for (const Antigen& antigen : strain)
     {
         //if antigen type hasn't already been counted... No need to increment because we're just marking whether or not it exists
-        if (antigenFreqs[get_phenotype_id(antigen)] == 0)
+        if (antigenFreqs[get_phenotype_id(params, antigen)] == 0)
             ++antigenCounter;
 
-        antigenFreqs[get_phenotype_id(antigen)] += 1;
+        antigenFreqs[get_phenotype_id(params, antigen)] += 1;
         totalCount++;
     }
 }
 
 
-void testing::new_tests()
+void testing::new_tests(ModelContext& ctx)
 {
-    utilities::initialise_random();
+    ctx.initialise_random();
+    ctx.diversity.reset();
+    ctx.distributions.reset();
     BITE_FREQUENCY_TABLE cumulativeBiteFrequencyDistribution;
-    cumulativeBiteFrequencyDistribution = ParamManager::get_cumulative_bite_frequency_distribution();
+    cumulativeBiteFrequencyDistribution = ctx.params.get_cumulative_bite_frequency_distribution();
     PTABLE pDeathMosquitoes;
-    pDeathMosquitoes = generate_mosquito_ptable();
-    Output output(nullptr);
+    pDeathMosquitoes = generate_mosquito_ptable(ctx.params);
+    Output output(ctx, nullptr);
     output.preinitialise_output_storage();
 
-    Strain strain = strain_from_antigen_pool({0*128, 1*128, 2*128, 3*128, 4*128, 5*128});
-    Host host;
-    host.kill();
-    host.age = 2;
-    host.infect(strain);
-    std::cout << "host infection1: " << strain_phenotype_str(host.infection1.strain) << "\n";
-    std::cout << "host infection2: " << strain_phenotype_str(host.infection2.strain) << "\n";
-
-    std::vector<Mosquito> mosquitoes;
+    Strain strain = strain_from_antigen_pool(ctx, {0*128, 1*128, 2*128, 3*128, 4*128, 5*128});
+    HostPopulation host(ctx);
+    host.resize(1);
+    host.kill(0);
+    host.set_age(0, 2);
+    host.infect(0, strain);
+    std::cout << "host infection1: " << strain_phenotype_str(ctx.params, host.get_strain(0, 0)) << "\n";
+    std::cout << "host infection2: " << strain_phenotype_str(ctx.params, host.get_strain(0, 1)) << "\n";
+
+    MosquitoPopulation mosquitoes(ctx);
+    mosquitoes.allocate(20);
     for (unsigned int i=0; i<20; i++) {
-        Mosquito newMos;
-        newMos.kill();
-        newMos.age = 1;
-        newMos.active = true;
-
-        mosquitoes.push_back(newMos);
+        unsigned int iM = mosquitoes.add();
+        mosquitoes.set_age(iM, 1);
     }
 
     std::cout << "Mosquito infection status\n";
     for (unsigned int i=0; i<mosquitoes.size(); ++i) {
-        if (mosquitoes[i].is_infected())
+        if (mosquitoes.is_infected(i))
             std::cout << i << ", infected\n";
         else
             std::cout << i << ", uninfected\n";
@@ -102,7 +105,7 @@ void testing::new_tests()
     //feed once
     for (unsigned int i=0; i<mosquitoes.size(); ++i)
     {
-        float p = utilities::random_float01()*cumulativeBiteFrequencyDistribution.back();
+        float p = ctx.rng().random_float01()*cumulativeBiteFrequencyDistribution.back();
         unsigned int numBites = 0;
         while (p > cumulativeBiteFrequencyDistribution[numBites])
             ++numBites;
@@ -111,14 +114,14 @@ void testing::new_tests()
         std::cout << "mosquito " << i << " feeds " << numBites << " times...\n";
         for (unsigned int b=0; b<numBites; ++b)
         {
-            mosquitoes[i].feed(host, &output, false);
+            mosquitoes.feed(i, host, 0, &output, false);
         }
     }
 
     std::cout << "Mosquito infection status\n";
     std::vector<unsigned int> infectedMossys;
     for (unsigned int i=0; i<mosquitoes.size(); ++i) {
-        if (mosquitoes[i].is_infected()) {
+        if (mosquitoes.is_infected(i)) {
             std::cout << i << ", infected\n";
             infectedMossys.push_back(i);
         }
@@ -128,25 +131,26 @@ void testing::new_tests()
     std::cout << "\n\nThere are " << infectedMossys.size() << " infected mosquitoes.\n";
 
     if (infectedMossys.size() >= 1) {
-        Mosquito infMos = mosquitoes[infectedMossys[0]];
-        if (infMos.is_infected())
-            std::cout << "At least one infected mosquito aged: " << infMos.age << "\n" << "Infecting strain:\n" << strain_phenotype_str(infMos.infection.strain) << "\n\n\n";
+        unsigned int infMos = infectedMossys[0];
+        if (mosquitoes.is_infected(infMos))
+            std::cout << "At least one infected mosquito aged: " << mosquitoes.get_age(infMos) << "\n" << "Infecting strain:\n" << strain_phenotype_str(ctx.params, mosquitoes.get_strain(infMos)) << "\n\n\n";
 
-        std::cout << "\nAging first infected mosquito...\n";
-        while (infMos.age != 0)
+        std::cout << "\nAging first infected mosquito's block...\n";
+        const unsigned int infBlock = infMos / MosquitoPopulation::BLOCK_SIZE;
+        while (mosquitoes.get_age(infMos) != 0)
         {
-            infMos.age_mosquito(pDeathMosquitoes);
-            std::cout << "New infected mosquito age: " << infMos.age << "\n";
+            mosquitoes.age_block(infBlock, pDeathMosquitoes);
+            std::cout << "New infected mosquito age: " << mosquitoes.get_age(infMos) << "\n";
         }
 
         std::cout << "Infected mosquito has died!\n";
         std::cout << "Replacement individual specifications:\n";
-        std::cout << "\tage :" << infMos.age << "\n";
+        std::cout << "\tage :" << mosquitoes.get_age(infMos) << "\n";
         std::cout << "\tinfection status : ";
-        if (infMos.is_infected()) {
+        if (mosquitoes.is_infected(infMos)) {
             std::cout << "infected\n";
             std::cout << "strain:\n";
-            std::cout << strain_phenotype_str(infMos.infection.strain) << "\n\n";
+            std::cout << strain_phenotype_str(ctx.params, mosquitoes.get_strain(infMos)) << "\n\n";
         }
         else std::cout << "uninfected\n";
     }
@@ -173,59 +177,116 @@ void testing::new_tests()
 
 
 
-void testing::run_tests()
+namespace
+{
+//Runs a small model (output every 20 days) to 'runTime', as runName.
+void run_resume_test_model(const std::string& runName, const unsigned int runTime, const unsigned int checkpointInterval, const std::string& resumeFrom)
+{
+    ModelContext ctx;
+    ModelDriver model(ctx);
+    ctx.params.runName = runName;
+    ctx.params.random_seed = 11;
+    ctx.params.run_time = runTime;
+    ctx.params.burn_in_period = 100;
+    ctx.params.output_interval = 20;
+    ctx.params.num_hosts = 1000;
+    ctx.params.initial_num_mosquitoes = 1000;
+    ctx.params.num_phenotypes = 1000;
+    ctx.params.output_memory = false;
+    ctx.params.checkpoint_interval = checkpointInterval;
+    ctx.params.resume_from = resumeFrom;
+    ctx.params.recalculate_derived_parameters();
+    model.run_model();
+}
+
+std::vector<std::string> read_lines(const std::string& filename)
+{
+    std::ifstream file(filename);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+        lines.push_back(line);
+    return lines;
+}
+}
+
+bool testing::test_checkpoint_resume(const unsigned int numThreads)
+{
+    //Threads may infect hosts in a different order, so only the output times and series lengths are expected to match exactly.
+    utilities::set_num_threads(numThreads);
+    run_resume_test_model("test_resume_full", 400, 0, "");
+    run_resume_test_model("test_resume_checkpointed", 300, 150, ""); //Last checkpoint at t=300, an output day.
+    run_resume_test_model("test_resume_resumed", 400, 0, "test_resume_checkpointed_checkpoint.bin");
+
+    const std::vector<std::string> expected = read_lines("test_resume_full_timesteps.csv");
+    const std::string series[] = {"timesteps", "host_prevalences", "moi", "eir"};
+    for (const std::string& name : series)
+    {
+        const std::vector<std::string> resumed = read_lines("test_resume_resumed_"+name+".csv");
+        if (resumed.size() != expected.size() || (name == "timesteps" && resumed != expected)) {
+            std::cout << "test_checkpoint_resume FAILED: resumed " << name << " has " << resumed.size() << " outputs, expected " << expected.size() << ".\n";
+            return false;
+        }
+    }
+    std::cout << "test_checkpoint_resume passed.\n";
+    return true;
+}
+
+void testing::run_tests(ModelContext& ctx)
 {
-    test_immunity();
-    test_host_infection();
+    test_immunity(ctx);
+    test_host_infection(ctx);
 }
 
-void testing::test_immunity()
+void testing::test_immunity(ModelContext& ctx)
 {
     //Does infection alter immune state?
-    Host host;
-    host.kill();
-    Strain strain = strain_from_antigen_pool({0*128, 1*128, 2*128, 3*128, 4*128, 5*128});
+    HostPopulation host(ctx);
+    host.resize(1);
+    host.kill(0);
+    Strain strain = strain_from_antigen_pool(ctx, {0*128, 1*128, 2*128, 3*128, 4*128, 5*128});
 
     std::cout << "*****Testing immune state*****\n";
     std::cout << "strain phenotype:\n";
     for (const Antigen a : strain)
-        std::cout << get_phenotype_id(a) << ", ";
+        std::cout << get_phenotype_id(ctx.params, a) << ", ";
     std::cout << "\n\n";
 
     std::cout << "old immune state:\n";
     for (unsigned int i=0; i<10; i++)
-        std::cout << host.immuneState[i] << ", ";
+        std::cout << host.get_immune_state(0)[i] << ", ";
     std::cout << "\n\n";
 
-    host.infect(strain);
+    host.infect(0, strain);
     std::cout << "new immune state:\n";
     for (unsigned int i=0; i<10; i++)
-        std::cout << host.immuneState[i] << ", ";
+        std::cout << host.get_immune_state(0)[i] << ", ";
     std::cout << "\n\n";
 
-    std::cout << "induced infection length = " << host.infection1.durationRemaining << "\n";
-    host.infection1.reset();
-    std::cout << "after clearing, duration = " << host.infection1.durationRemaining << "\n";
-    host.infect(strain);
-    std::cout << "after reinfecting, duration = " << host.infection1.durationRemaining << "\n";
+    std::cout << "induced infection length = " << host.get_duration_remaining(0, 0) << "\n";
+    host.clear_infection(0, 0);
+    std::cout << "after clearing, duration = " << host.get_duration_remaining(0, 0) << "\n";
+    host.infect(0, strain);
+    std::cout << "after reinfecting, duration = " << host.get_duration_remaining(0, 0) << "\n";
 
     std::cout << "\n\n\n";
 }
 
-void testing::test_host_infection()
+void testing::test_host_infection(ModelContext& ctx)
 {
-    Host host;
-    host.kill();
-    Strain strain = strain_from_antigen_pool({0*128, 1*128, 2*128, 3*128, 4*128, 5*128});
-
-    host.infect(strain);
-    std::cout << "Infected strain. Duration = " << host.infection1.durationRemaining << " infection status: " << host.infection1.infected << "\n";
-    host.update_infections();
-    std::cout << "updated host infection once. Duration = " << host.infection1.durationRemaining << " infection status: " << host.infection1.infected << "\n";
-    host.update_infections();
-    std::cout << "updated host infection once. Duration = " << host.infection1.durationRemaining << " infection status: " << host.infection1.infected << "\n";
-    host.update_infections();
-    std::cout << "updated host infection once. Duration = " << host.infection1.durationRemaining << " infection status: " << host.infection1.infected << "\n";
-    host.update_infections();
-    std::cout << "updated host infection once. Duration = " << host.infection1.durationRemaining << " infection status: " << host.infection1.infected << "\n";
+    HostPopulation host(ctx);
+    host.resize(1);
+    host.kill(0);
+    Strain strain = strain_from_antigen_pool(ctx, {0*128, 1*128, 2*128, 3*128, 4*128, 5*128});
+
+    host.infect(0, strain);
+    std::cout << "Infected strain. Duration = " << host.get_duration_remaining(0, 0) << " infection status: " << host.is_infected(0, 0) << "\n";
+    host.expire_infections(1);
+    std::cout << "updated host infection once. Duration = " << host.get_duration_remaining(0, 0) << " infection status: " << host.is_infected(0, 0) << "\n";
+    host.expire_infections(2);
+    std::cout << "updated host infection once. Duration = " << host.get_duration_remaining(0, 0) << " infection status: " << host.is_infected(0, 0) << "\n";
+    host.expire_infections(3);
+    std::cout << "updated host infection once. Duration = " << host.get_duration_remaining(0, 0) << " infection status: " << host.is_infected(0, 0) << "\n";
+    host.expire_infections(4);
+    std::cout << "updated host infection once. Duration = " << host.get_duration_remaining(0, 0) << " infection status: " << host.is_infected(0, 0) << "\n";
 }
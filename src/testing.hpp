@@ -2,19 +2,25 @@
 
 #include <vector>
 #include "global_typedefs.hpp"
-#include "host.hpp"
-#include "mosquito.hpp"
+#include "host_population.hpp"
+#include "mosquito_population.hpp"
+
+class ModelContext;
 
 namespace testing
 {
     void test_diversity_counting();
-    void long_diversity_count(unsigned int& uniqueCount, unsigned int& totalCount, const std::vector<Host>& hosts, const std::vector<Mosquito>& mosquitoes);
-    void long_diversity_count_helper(std::vector<unsigned int>& antigenFreqs, unsigned int& antigenCounter, const Strain& strain, unsigned int &totalCount);
+    void long_diversity_count(const ParamManager& params, unsigned int& uniqueCount, unsigned int& totalCount, const HostPopulation& hosts, const MosquitoPopulation& mosquitoes);
+    void long_diversity_count_helper(const ParamManager& params, std::vector<unsigned int>& antigenFreqs, unsigned int& antigenCounter, const Strain& strain, unsigned int &totalCount);
+
+    void new_tests(ModelContext& ctx);
 
-    void new_tests();
+    void run_tests(ModelContext& ctx);
 
-    void run_tests();
+    void test_immunity(ModelContext& ctx);
+    void test_host_infection(ModelContext& ctx);
 
-    void test_immunity();
-    void test_host_infection();
+    //Resumes a multi threaded run from a checkpoint saved on an output day and checks it outputs the same times, once each, as a run
+    //that was never checkpointed. Writes test_resume_* files to the working directory. Returns false (and says why) on a mismatch.
+    bool test_checkpoint_resume(const unsigned int numThreads = 2);
 }
@@ -0,0 +1,58 @@
+#pragma once
+#include "checkpoint.hpp"
+#include <vector>
+
+//Hashed timing wheel (calendar queue) of events keyed by day. Scheduling and expiring an event are both O(1), so the cost of a day
+//depends on how many events are due rather than on how many agents could have an event.
+//Event must have an unsigned 'day' member. Events more than one rotation ahead just stay in their bucket until their day comes round.
+//Events aren't cancelled: whoever processes them should check they are still valid (e.g. the infection hasn't already been cleared).
+template <typename Event>
+class TimingWheel
+{
+private:
+    std::vector<std::vector<Event>> buckets;
+    unsigned int mask;
+
+public:
+    TimingWheel(const unsigned int numBucketsLog2 = 10) : buckets(1u << numBucketsLog2), mask((1u << numBucketsLog2) - 1) {  }
+
+    void clear()
+    {
+        for (std::vector<Event>& bucket : buckets)
+            bucket.clear();
+    }
+
+    size_t memory_bytes() const
+    {
+        size_t bytes = buckets.capacity() * sizeof(std::vector<Event>);
+        for (const std::vector<Event>& bucket : buckets)
+            bytes += bucket.capacity() * sizeof(Event);
+        return bytes;
+    }
+
+    //Buckets are saved in order, so events expire in the same order after a restart.
+    void save(checkpoint::Writer& out) const { out.write_vectors(buckets); }
+    void load(checkpoint::Reader& in)
+    {
+        in.read_vectors(buckets);
+        mask = buckets.size() - 1;
+    }
+
+    void schedule(const Event& event) { buckets[event.day & mask].push_back(event); }
+
+    //Calls process(event) for every event due on 'day'. Events for later rotations are kept.
+    template <typename Function>
+    void expire(const unsigned int day, Function process)
+    {
+        std::vector<Event>& bucket = buckets[day & mask];
+        unsigned int kept = 0;
+        for (unsigned int i=0; i<bucket.size(); ++i)
+        {
+            if (bucket[i].day == day)
+                process(bucket[i]);
+            else if (bucket[i].day > day)
+                bucket[kept++] = bucket[i];
+        }
+        bucket.erase(bucket.begin()+kept, bucket.end());
+    }
+};
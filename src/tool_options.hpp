@@ -0,0 +1,36 @@
+#pragma once
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Command line parsing shared by the benchmark and validation tools, which take 'name value' pairs like the model does.
+namespace tool_options
+{
+    //Comma separated list, e.g. "1,2,4". Empty items are skipped.
+    inline std::vector<std::string> split(const std::string& list)
+    {
+        std::vector<std::string> items;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            if (!item.empty())
+                items.push_back(item);
+        }
+        return items;
+    }
+
+    //argv's 'name value' pairs, in order. 'tool' names the caller in the std::runtime_error thrown for an odd number of arguments.
+    inline std::vector<std::pair<std::string, std::string>> read_pairs(int argc, char* argv[], const std::string& tool)
+    {
+        if ((argc-1) % 2 != 0)
+            throw std::runtime_error(tool + ": Mismatched number of command line arguments. Cannot parse token:value pairs.");
+
+        std::vector<std::pair<std::string, std::string>> pairs;
+        for (int i=1; i<argc; i+=2)
+            pairs.push_back(std::make_pair(std::string(argv[i]), std::string(argv[i+1])));
+        return pairs;
+    }
+}
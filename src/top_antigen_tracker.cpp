@@ -0,0 +1,111 @@
+#include "top_antigen_tracker.hpp"
+#include "checkpoint.hpp"
+#include "memory_report.hpp"
+#include <algorithm>
+
+void TopAntigenTracker::reset(const unsigned int _k, const unsigned int numPhenotypes)
+{
+    k = _k;
+    capacity = 2*_k;
+    monitored.clear();
+    unmonitoredBound = 0;
+    numFullScans = 0;
+
+    touchedBits.assign(k != 0 ? (numPhenotypes+63)/64 : 0, 0);
+    touchedLists.assign(utilities::max_threads(), std::vector<uint32_t>());
+}
+
+//Keeps the best 'capacity' candidates (with non-zero counts) as the monitored set. Those dropped can't count more than unmonitoredBound.
+void TopAntigenTracker::rank(std::vector<uint32_t>& candidates, const std::vector<unsigned int>& counts)
+{
+    auto higher = [&counts](const uint32_t a, const uint32_t b) { return counts[a] > counts[b] || (counts[a] == counts[b] && a < b); };
+
+    const size_t keep = std::min<size_t>(capacity, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin()+keep, candidates.end(), higher);
+
+    uint32_t droppedMax = 0;
+    for (size_t i=keep; i<candidates.size(); ++i)
+        droppedMax = std::max<uint32_t>(droppedMax, counts[candidates[i]]);
+    unmonitoredBound = std::max(unmonitoredBound, droppedMax);
+
+    monitored.clear();
+    for (size_t i=0; i<keep && counts[candidates[i]] > 0; ++i)
+        monitored.push_back(candidates[i]);
+}
+
+uint32_t TopAntigenTracker::update(const std::vector<unsigned int>& counts, std::vector<Entry>& top)
+{
+    top.clear();
+    if (!enabled())
+        return 0;
+
+    //Candidates: monitored antigens plus everything touched since the last update (each once).
+    std::vector<uint32_t> candidates;
+    for (uint32_t antigen : monitored)
+    {
+        if (!(touchedBits[antigen >> 6] & (1ull << (antigen & 63))))
+            candidates.push_back(antigen);
+    }
+    for (std::vector<uint32_t>& touched : touchedLists)
+    {
+        for (uint32_t antigen : touched)
+        {
+            candidates.push_back(antigen);
+            touchedBits[antigen >> 6] = 0;
+        }
+        touched.clear();
+    }
+    rank(candidates, counts);
+
+    //The bound could hide an antigen which belongs in the top K, so rank everything. This also tightens the bound.
+    const uint32_t kthCount = monitored.size() >= k ? counts[monitored[k-1]] : 0;
+    if (unmonitoredBound > kthCount) {
+        candidates.clear();
+        for (uint32_t antigen=0; antigen<counts.size(); ++antigen)
+        {
+            if (counts[antigen] > 0)
+                candidates.push_back(antigen);
+        }
+        unmonitoredBound = 0;
+        rank(candidates, counts);
+        ++numFullScans;
+    }
+
+    for (size_t i=0; i<monitored.size() && i<k; ++i)
+        top.push_back(Entry(monitored[i], counts[monitored[i]]));
+
+    uint32_t unlistedMax = unmonitoredBound;
+    if (monitored.size() > k)
+        unlistedMax = std::max<uint32_t>(unlistedMax, counts[monitored[k]]);
+    return unlistedMax;
+}
+
+uint64_t TopAntigenTracker::memory_bytes() const
+{
+    uint64_t bytes = memory::vector_bytes(touchedBits) + memory::vector_bytes(touchedLists) + memory::vector_bytes(monitored);
+    for (const std::vector<uint32_t>& touched : touchedLists)
+        bytes += memory::vector_bytes(touched);
+    return bytes;
+}
+
+void TopAntigenTracker::save(checkpoint::Writer& out) const
+{
+    out.write(k);
+    out.write(capacity);
+    out.write_vector(touchedBits);
+    out.write_vectors(touchedLists);
+    out.write_vector(monitored);
+    out.write(unmonitoredBound);
+    out.write(numFullScans);
+}
+
+void TopAntigenTracker::load(checkpoint::Reader& in)
+{
+    in.read(k);
+    in.read(capacity);
+    in.read_vector(touchedBits);
+    in.read_vectors(touchedLists);
+    in.read_vector(monitored);
+    in.read(unmonitoredBound);
+    in.read(numFullScans);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "utilities.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace checkpoint { class Writer; class Reader; }
+
+//Tracks the K most abundant antigens without scanning the whole phenotype space at every output.
+//DiversityMonitor touch()es an antigen whenever its count changes. At each output only the monitored candidates (the best 2K last time)
+//and the antigens touched since are re-ranked, using the monitor's exact counts. An antigen which is neither must have had its count
+//at the last ranking it took part in, which was below every candidate kept then, so unmonitoredBound bounds it. If that bound could
+//beat the Kth count, the ranking falls back to a full scan, so the reported top K is always exact.
+class TopAntigenTracker
+{
+public:
+    typedef std::pair<uint32_t, uint32_t> Entry; //antigen, count
+
+private:
+    unsigned int k = 0;
+    unsigned int capacity = 0; //Number of monitored candidates kept between outputs.
+    std::vector<uint64_t> touchedBits; //One bit per phenotype, set on the first touch since the last update().
+    std::vector<std::vector<uint32_t>> touchedLists; //Per thread: antigens whose bit that thread set.
+    std::vector<uint32_t> monitored;
+    uint32_t unmonitoredBound = 0; //Upper bound on the count of any antigen that is neither monitored nor touched.
+    unsigned int numFullScans = 0;
+
+    void rank(std::vector<uint32_t>& candidates, const std::vector<unsigned int>& counts);
+
+public:
+    void reset(const unsigned int _k, const unsigned int numPhenotypes); //k == 0 disables tracking.
+    bool enabled() const { return k != 0; }
+
+    //Thread safe. Called for every change in an antigen's count.
+    void touch(const uint32_t antigen)
+    {
+        uint64_t& word = touchedBits[antigen >> 6];
+        const uint64_t bit = 1ull << (antigen & 63);
+        uint64_t old;
+        #pragma omp atomic read
+        old = word;
+        if (old & bit) //Usually already touched, so avoid the read-modify-write.
+            return;
+
+        #pragma omp atomic capture
+        { old = word; word |= bit; }
+        if (!(old & bit))
+            touchedLists[utilities::thread_num()].push_back(antigen);
+    }
+
+    //Not thread safe (no concurrent touch()es). Fills 'top' with the K most abundant antigens in descending order of count (fewer if
+    //fewer antigens are circulating) and returns the largest count any unlisted antigen has.
+    uint32_t update(const std::vector<unsigned int>& counts, std::vector<Entry>& top);
+
+    unsigned int get_num_full_scans() const { return numFullScans; }
+    uint64_t memory_bytes() const;
+    void save(checkpoint::Writer& out) const;
+    void load(checkpoint::Reader& in);
+};
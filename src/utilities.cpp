@@ -1,21 +1,50 @@
 #include "utilities.hpp"
-#include "param_manager.hpp"
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
 #include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-void utilities::initialise_random()
+void utilities::RandomStream::set_seed(uint64_t seed)
 {
-    auto seed = time(NULL);
-    srand(seed);
+    state = splitmix64(seed);
+    if (state == 0) //xorshift has a fixed point at zero.
+        state = 0x9E3779B97F4A7C15ULL;
+}
+
+uint64_t utilities::splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+unsigned int utilities::thread_num()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
 
-    std::ofstream file;
-    file.open(ParamManager::file_path()+ParamManager::run_name()+"_seed.txt", std::ofstream::out | std::ofstream::trunc);
-    file << seed;
+unsigned int utilities::max_threads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
 
-    file.flush();
-    file.close();
+void utilities::set_num_threads(const unsigned int n)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(n);
+#endif
 }
 
 int utilities::wrap(int number, int low, int high)
@@ -32,29 +61,6 @@ int utilities::wrap(int number, int low, int high)
     return number;
 }
 
-int utilities::random(int start, int end)
-{
-    return start + rand() % (end-start);
-}
-
-
-unsigned int utilities::urandom(unsigned int start, unsigned int end)
-{
-    return start + rand() % (end-start);
-}
-
-//Returns a uniform random float on the interval [0, 1]
-float utilities::random_float01()
-{
-    return ((float)rand() / (RAND_MAX));
-}
-
-//Returns a number on the interval [-1, 1]
-float utilities::random_float_m1_1()
-{
-    return (((float)rand() / (RAND_MAX))-0.5)*2.0;
-}
-
 long utilities::factorial(unsigned int k)
 {
     if (k==0)
@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <cstdint>
 #include <fstream>
 #include <string>
 
@@ -7,13 +8,48 @@
 
 namespace utilities
 {
-    void initialise_random();
+    //Fast xorshift64* pseudo random number generator. Each thread of each model run has its own stream (see ModelContext::rng) so
+    //threads / concurrently running models never share generator state. Satisfies UniformRandomBitGenerator (for std::shuffle).
+    class RandomStream
+    {
+    private:
+        uint64_t state;
+        char padding[120]; //Keeps the states of adjacent streams (one per thread) on separate cache lines.
+    public:
+        typedef uint64_t result_type;
+
+        explicit RandomStream(uint64_t seed = 1) { set_seed(seed); }
+        void set_seed(uint64_t seed);
+        uint64_t get_state() const { return state; }
+        void set_state(uint64_t newState) { state = newState; }
+
+        uint64_t next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+
+        int random(int start, int end) { return start + (int)urange(end-start); }
+        unsigned int urandom(unsigned int start, unsigned int end) { return start + urange(end-start); }
+
+        float random_float01() { return (next() >> 40) * (1.0f / 16777216.0f); } //Returns a number on the interval [0, 1)
+        float random_float_m1_1() { return (random_float01()-0.5f)*2.0f; } //Returns a number on the interval [-1, 1)
+
+        //Returns a uniform integer on [0, range) using the high bits (multiply-shift rather than modulo).
+        unsigned int urange(unsigned int range) { return (unsigned int)(((next() >> 32) * (uint64_t)range) >> 32); }
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+        result_type operator()() { return next(); }
+    };
 
-    int random(int start, int end);
-    unsigned int urandom(unsigned int start, unsigned int end);
+    uint64_t splitmix64(uint64_t x); //Used to derive well separated seeds for each stream from one run seed.
 
-    float random_float01(); //Returns a number on the interval [0, 1]
-    float random_float_m1_1(); //Returns a number on the interval [-1, 1]
+    unsigned int thread_num(); //Index of the calling thread in the current OpenMP team (0 without OpenMP).
+    unsigned int max_threads(); //Number of threads a parallel region started now would use (1 without OpenMP).
+    void set_num_threads(const unsigned int n); //Sets the number of threads later parallel regions use (ignored without OpenMP).
 
     int wrap(int number, int low, int high);
 
@@ -0,0 +1,255 @@
+//Statistical equivalence check of two builds of the model (the Equivalence build target). Usage, 'name value' pairs:
+//  equivalence_harness reference <model executable> candidate <model executable> [replicates 20] [alpha 0.01] [work_dir equivalence/]
+//                      [reference_seeds true]
+//                      [series host_prevalences,mosquito_prevalences,eir,moi,shannon_entropy_diversity,num_circulating_antigens] [model parameters...]
+//Optimisations which change how random numbers are drawn can't be checked by comparing outputs byte for byte, so instead both builds
+//are run 'replicates' times on a small scenario (with different seeds) and, for every series and output time, the reference and
+//candidate replicates are compared with a two-sample Kolmogorov-Smirnov test. Each series' time average is tested the same way.
+//The run fails (exit code 1) if any test is significant at 'alpha' after a Bonferroni correction for the number of tests.
+//Model parameters given here override the scenario below and are passed to both builds. Per test results go to work_dir/equivalence.csv.
+//Builds from before random_seed existed seed from the clock and reject the parameter: give reference_seeds false for those, and
+//reference runs are started in different seconds instead.
+#include "../tool_options.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+
+namespace
+{
+struct Options
+{
+    std::string reference;
+    std::string candidate;
+    unsigned int replicates = 20;
+    double alpha = 0.01;
+    std::string workDir = "equivalence/";
+    bool referenceSeeds = true; //Pass random_seed to the reference build.
+    std::vector<std::string> series = {"host_prevalences", "mosquito_prevalences", "eir", "moi", "shannon_entropy_diversity", "num_circulating_antigens"};
+    //Only parameters every build accepts (set_param throws on unknown names), so that the reference can be an old build.
+    std::vector<std::pair<std::string, std::string>> params = {
+        {"run_time", "2000"}, {"output_interval", "50"}, {"burn_in_period", "500"}, {"num_hosts", "1000"}, {"initial_num_mosquitoes", "1000"},
+        {"initial_num_mosquito_infections", "100"}, {"num_phenotypes", "2000"}, {"initial_antigen_diversity", "500"}};
+};
+
+struct TestResult
+{
+    std::string series;
+    int timeIndex; //-1 for the time average.
+    double statistic;
+    double pValue;
+    double referenceMean;
+    double candidateMean;
+};
+
+void set_option(std::vector<std::pair<std::string, std::string>>& params, const std::string& name, const std::string& value)
+{
+    for (std::pair<std::string, std::string>& param : params)
+    {
+        if (param.first == name) {
+            param.second = value;
+            return;
+        }
+    }
+    params.push_back(std::make_pair(name, value));
+}
+
+//One value per line, as Output writes a series.
+std::vector<double> read_series(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+        throw std::runtime_error("equivalence_harness: cannot open " + filename + " (is the series output by this scenario?)");
+    std::vector<double> values;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty())
+            values.push_back(std::stod(line));
+    }
+    return values;
+}
+
+void run_model(const std::string& executable, const std::string& runName, const unsigned int seed, const Options& options)
+{
+    std::ostringstream command;
+    command << "'" << executable << "' run_name " << runName << " file_path '" << options.workDir << "'";
+    if (seed != 0) //0 = the build seeds itself from the clock.
+        command << " random_seed " << seed;
+    for (const std::pair<std::string, std::string>& param : options.params)
+        command << " " << param.first << " " << param.second;
+    command << " > /dev/null";
+
+    if (std::system(command.str().c_str()) != 0)
+        throw std::runtime_error("equivalence_harness: model run failed: " + command.str());
+}
+
+//Kolmogorov distribution tail, P(K > lambda).
+double kolmogorov_q(const double lambda)
+{
+    if (lambda < 0.2)
+        return 1.0;
+    double sum = 0.0;
+    for (int j=1; j<=100; ++j)
+    {
+        const double term = 2.0 * ((j % 2 == 1) ? 1.0 : -1.0) * std::exp(-2.0 * j * j * lambda * lambda);
+        sum += term;
+        if (std::fabs(term) < 1e-12)
+            break;
+    }
+    return std::min(1.0, std::max(0.0, sum));
+}
+
+//Two-sample KS statistic (largest gap between the empirical CDFs) and its asymptotic p-value, with Stephens' small sample correction.
+std::pair<double, double> ks_test(std::vector<double> a, std::vector<double> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    size_t i = 0, j = 0;
+    double d = 0.0;
+    while (i < a.size() && j < b.size())
+    {
+        const double x = std::min(a[i], b[j]);
+        while (i < a.size() && a[i] == x)
+            ++i;
+        while (j < b.size() && b[j] == x)
+            ++j;
+        d = std::max(d, std::fabs((double)i/a.size() - (double)j/b.size()));
+    }
+    const double ne = std::sqrt((double)a.size()*b.size() / (a.size()+b.size()));
+    return std::make_pair(d, kolmogorov_q((ne + 0.12 + 0.11/ne) * d));
+}
+
+double mean(const std::vector<double>& values)
+{
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+//replicates x times -> the values at each time (only times every replicate reached).
+std::vector<std::vector<double>> by_time(const std::vector<std::vector<double>>& replicates)
+{
+    size_t numTimes = replicates.front().size();
+    for (const std::vector<double>& replicate : replicates)
+        numTimes = std::min(numTimes, replicate.size());
+    std::vector<std::vector<double>> samples(numTimes);
+    for (const std::vector<double>& replicate : replicates)
+    {
+        for (size_t t=0; t<numTimes; ++t)
+            samples[t].push_back(replicate[t]);
+    }
+    return samples;
+}
+
+void parse_options(int argc, char* argv[], Options& options)
+{
+    for (const std::pair<std::string, std::string>& pair : tool_options::read_pairs(argc, argv, "equivalence_harness"))
+    {
+        const std::string& token = pair.first;
+        const std::string& value = pair.second;
+        if (token == "reference")
+            options.reference = value;
+        else if (token == "candidate")
+            options.candidate = value;
+        else if (token == "replicates")
+            options.replicates = std::max(2, std::stoi(value));
+        else if (token == "alpha")
+            options.alpha = std::stod(value);
+        else if (token == "work_dir")
+            options.workDir = value;
+        else if (token == "reference_seeds")
+            options.referenceSeeds = (value == "true" || value == "1" || value == "True" || value == "TRUE");
+        else if (token == "series")
+            options.series = tool_options::split(value);
+        else
+            set_option(options.params, token, value);
+    }
+
+    if (options.reference.empty() || options.candidate.empty())
+        throw std::runtime_error("equivalence_harness: both 'reference' and 'candidate' model executables must be given.");
+    if (!options.workDir.empty() && options.workDir.back() != '/')
+        options.workDir += "/";
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    parse_options(argc, argv, options);
+    mkdir(options.workDir.c_str(), 0777);
+
+    //Seeds differ between the builds, so that the samples are independent even if the candidate draws random numbers identically.
+    std::vector<std::vector<std::vector<double>>> reference(options.series.size()), candidate(options.series.size()); //series x replicate x time
+    time_t lastReferenceStart = 0;
+    for (unsigned int r=0; r<options.replicates; ++r)
+    {
+        std::cout << "replicate " << r+1 << "/" << options.replicates << std::endl;
+        if (!options.referenceSeeds) { //Clock seeded: make sure this run gets a different second (and so seed) from the last.
+            while (time(NULL) == lastReferenceStart)
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            lastReferenceStart = time(NULL);
+        }
+        run_model(options.reference, "reference", options.referenceSeeds ? 1+r : 0, options);
+        run_model(options.candidate, "candidate", 1000001+r, options);
+        for (unsigned int s=0; s<options.series.size(); ++s)
+        {
+            reference[s].push_back(read_series(options.workDir + "reference_" + options.series[s] + ".csv"));
+            candidate[s].push_back(read_series(options.workDir + "candidate_" + options.series[s] + ".csv"));
+        }
+    }
+
+    std::vector<TestResult> results;
+    for (unsigned int s=0; s<options.series.size(); ++s)
+    {
+        const std::vector<std::vector<double>> referenceByTime = by_time(reference[s]);
+        const std::vector<std::vector<double>> candidateByTime = by_time(candidate[s]);
+        const size_t numTimes = std::min(referenceByTime.size(), candidateByTime.size());
+        for (size_t t=0; t<numTimes; ++t)
+        {
+            const std::pair<double, double> test = ks_test(referenceByTime[t], candidateByTime[t]);
+            results.push_back(TestResult{options.series[s], (int)t, test.first, test.second, mean(referenceByTime[t]), mean(candidateByTime[t])});
+        }
+
+        std::vector<double> referenceAverages, candidateAverages;
+        for (const std::vector<double>& replicate : reference[s])
+            referenceAverages.push_back(mean(replicate));
+        for (const std::vector<double>& replicate : candidate[s])
+            candidateAverages.push_back(mean(replicate));
+        const std::pair<double, double> test = ks_test(referenceAverages, candidateAverages);
+        results.push_back(TestResult{options.series[s], -1, test.first, test.second, mean(referenceAverages), mean(candidateAverages)});
+    }
+
+    const double threshold = options.alpha / std::max<size_t>(1, results.size());
+    std::ofstream file;
+    file.open(options.workDir + "equivalence.csv", std::ofstream::out | std::ofstream::trunc);
+    file << "series, output_index, ks_statistic, p_value, reference_mean, candidate_mean, significant\n";
+    unsigned int numSignificant = 0;
+    for (const TestResult& result : results)
+    {
+        const bool significant = result.pValue < threshold;
+        numSignificant += significant;
+        file << result.series << ", " << (result.timeIndex < 0 ? std::string("time_average") : std::to_string(result.timeIndex)) << ", " << result.statistic << ", "
+             << result.pValue << ", " << result.referenceMean << ", " << result.candidateMean << ", " << significant << "\n";
+        if (significant) {
+            std::cout << "DIVERGED: " << result.series << " at " << (result.timeIndex < 0 ? std::string("time average") : "output " + std::to_string(result.timeIndex))
+                      << " (D=" << result.statistic << ", p=" << result.pValue << ", means " << result.referenceMean << " vs " << result.candidateMean << ")\n";
+        }
+    }
+    file.close();
+
+    std::cout << results.size() << " tests, Bonferroni threshold p < " << threshold << ": " << (numSignificant == 0 ? "PASSED" : "FAILED")
+              << " (" << numSignificant << " significant)." << std::endl;
+    return numSignificant == 0 ? 0 : 1;
+}